@@ -6,7 +6,7 @@ declare version "1.0";
 
 import("stdfaust.lib");
 
-OS = fconstant(int gOversampling, <math.h>);
+OS = fconstant(float gOversampling, <math.h>);
 
 process = os.lf_triangle(frequency/OS) with {
   note = hslider("[1] Note [unit:semitone]", 69, 0, 127, 1);
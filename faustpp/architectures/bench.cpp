@@ -0,0 +1,366 @@
+#include "{{Identifier}}.hpp"
+
+//------------------------------------------------------------------------------
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+// A benchmark of the DSP, which times the processing for a range of block
+// sizes, with the parameters fixed at their defaults, and swept between their
+// bounds at every block. The oversampling factor is the one of the generated
+// class, so the comparison of factors is a benchmark for each of them.
+//
+// The table reports the time per sample, the realtime factor, and the
+// percentiles of the time per sample among the blocks. With the option `-c`,
+// it also reports the counters of the processor, if the kernel permits.
+
+static const char BenchOversampling[] = {{cstr(Oversampling|default(1)|string)}};
+
+enum BenchMode {
+    BenchStatic,
+    BenchSweep,
+};
+
+struct BenchOptions {
+    unsigned sample_rate = 48000;
+    std::vector<unsigned> block_sizes { 16, 32, 64, 128, 256, 512, 1024, 2048 };
+    double duration = 5;
+    bool run_static = true;
+    bool run_sweep = true;
+    int sweep_parameter = -1;
+    bool counters = false;
+    bool csv = false;
+};
+
+struct BenchResult {
+    double ns_per_sample = 0;
+    double realtime_factor = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+    // the counters, if available
+    bool has_counters = false;
+    double cycles_per_sample = 0;
+    double ipc = 0;
+    double misses_per_ksample = 0;
+};
+
+static uint64_t monotonic_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+// The counters of the processor
+
+struct PerfCounters {
+    ~PerfCounters();
+    bool open();
+    void start();
+    // the cycles, instructions and cache misses since the start
+    bool stop(uint64_t values[3]);
+
+    int fds[3] = { -1, -1, -1 };
+};
+
+PerfCounters::~PerfCounters()
+{
+    for (int fd : fds) {
+        if (fd != -1)
+            close(fd);
+    }
+}
+
+bool PerfCounters::open()
+{
+    const uint64_t events[3] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+    };
+    for (unsigned i = 0; i < 3; ++i) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = events[i];
+        attr.disabled = (i == 0);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        // the first counter leads the group, so the others count together
+        fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, (i == 0) ? -1 : fds[0], 0);
+        if (fds[i] == -1)
+            return false;
+    }
+    return true;
+}
+
+void PerfCounters::start()
+{
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+bool PerfCounters::stop(uint64_t values[3])
+{
+    ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    uint64_t data[1 + 3];
+    if (read(fds[0], data, sizeof(data)) != (ssize_t)sizeof(data) || data[0] != 3)
+        return false;
+    std::memcpy(values, data + 1, 3 * sizeof(uint64_t));
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// The measure
+
+// the value of the parameter at the phase of the sweep, between 0 and 1
+static float sweep_value(unsigned index, double phase)
+{
+    const {{Identifier}}::ParameterRange *range = {{Identifier}}::parameter_range(index);
+    double position = (phase < 0.5) ? (2 * phase) : (2 - 2 * phase);
+    if ({{Identifier}}::parameter_is_logarithmic(index) && range->min > 0)
+        return (float)(range->min * std::pow((double)range->max / range->min, position));
+    return (float)(range->min + position * (range->max - range->min));
+}
+
+static double percentile(std::vector<double> &values, double p)
+{
+    size_t index = (size_t)(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+static BenchResult measure(const BenchOptions &options, unsigned block, BenchMode mode, PerfCounters *counters)
+{
+    std::unique_ptr<{{Identifier}}> dsp(new {{Identifier}});
+    dsp->init(options.sample_rate);
+
+    // a white noise at -12 dB, the same at each run
+    std::vector<float> input((size_t)({{inputs}}) * block);
+    std::vector<float> output((size_t)({{outputs}}) * block);
+    uint32_t x = 1;
+    for (float &sample : input) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        sample = 0.25f * ((float)x / 2147483648.0f - 1.0f);
+    }
+    float *in = input.data();
+    float *out = output.data();
+    (void)in;
+    (void)out;
+
+    const size_t count = std::max<size_t>(1, (size_t)(options.duration * options.sample_rate / block));
+    // a sweep in both directions every second
+    const size_t sweep_blocks = std::max<size_t>(2, options.sample_rate / block);
+
+    auto run_block = [&](size_t i) {
+        {% if active|length > 0 %}
+        if (mode == BenchSweep) {
+            double phase = (double)(i % sweep_blocks) / sweep_blocks;
+            for (unsigned p = 0; p < {{Identifier}}::NumActives; ++p) {
+                if (options.sweep_parameter == -1 || options.sweep_parameter == (int)p)
+                    dsp->set_parameter(p, sweep_value(p, phase));
+            }
+        }
+        {% else %}
+        (void)i;
+        (void)mode;
+        (void)sweep_blocks;
+        {% endif %}
+        dsp->process(
+            {% for i in range(inputs) %}in + {{i}} * block,{% endfor %}
+            {% for i in range(outputs) %}out + {{i}} * block,{% endfor %}
+            block);
+    };
+
+    // warm up the caches, and the frequency of the processor
+    const size_t warmup = std::min<size_t>(count, 1000);
+    for (size_t i = 0; i < warmup; ++i)
+        run_block(i);
+
+    std::vector<double> times(count);
+    if (counters)
+        counters->start();
+    uint64_t start = monotonic_ns();
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t block_start = monotonic_ns();
+        run_block(i);
+        times[i] = (double)(monotonic_ns() - block_start) / block;
+    }
+    uint64_t total = monotonic_ns() - start;
+
+    const double samples = (double)count * block;
+    BenchResult result;
+    uint64_t values[3];
+    if (counters && counters->stop(values)) {
+        result.has_counters = true;
+        result.cycles_per_sample = values[0] / samples;
+        result.ipc = values[0] ? (double)values[1] / values[0] : 0;
+        result.misses_per_ksample = 1e3 * values[2] / samples;
+    }
+
+    result.ns_per_sample = total / samples;
+    result.realtime_factor = 1e9 / (result.ns_per_sample * options.sample_rate);
+    result.p50 = percentile(times, 0.5);
+    result.p99 = percentile(times, 0.99);
+    result.max = *std::max_element(times.begin(), times.end());
+    return result;
+}
+
+//------------------------------------------------------------------------------
+
+static void print_header(const BenchOptions &options)
+{
+    if (options.csv) {
+        printf("dsp,oversampling,block,mode,ns_per_sample,realtime_factor,p50,p99,max");
+        if (options.counters)
+            printf(",cycles_per_sample,ipc,misses_per_ksample");
+        printf("\n");
+        return;
+    }
+
+    printf("{{Identifier}}, oversampling %s, %u Hz\n", BenchOversampling, options.sample_rate);
+    printf("%6s %6s %10s %10s %10s %10s %10s", "block", "mode", "ns/sample", "realtime", "p50", "p99", "max");
+    if (options.counters)
+        printf(" %10s %6s %12s", "cyc/sample", "IPC", "miss/ksample");
+    printf("\n");
+}
+
+static void print_result(const BenchOptions &options, unsigned block, BenchMode mode, const BenchResult &result)
+{
+    const char *mode_name = (mode == BenchSweep) ? "sweep" : "static";
+
+    if (options.csv) {
+        printf("{{Identifier}},%s,%u,%s,%.3f,%.1f,%.3f,%.3f,%.3f",
+               BenchOversampling, block, mode_name, result.ns_per_sample, result.realtime_factor,
+               result.p50, result.p99, result.max);
+        if (options.counters && result.has_counters)
+            printf(",%.2f,%.2f,%.3f", result.cycles_per_sample, result.ipc, result.misses_per_ksample);
+        else if (options.counters)
+            printf(",,,");
+        printf("\n");
+        return;
+    }
+
+    printf("%6u %6s %10.2f %10.1f %10.2f %10.2f %10.2f",
+           block, mode_name, result.ns_per_sample, result.realtime_factor, result.p50, result.p99, result.max);
+    if (result.has_counters)
+        printf(" %10.2f %6.2f %12.3f", result.cycles_per_sample, result.ipc, result.misses_per_ksample);
+    printf("\n");
+}
+
+static bool parse_block_sizes(const char *text, std::vector<unsigned> &sizes)
+{
+    sizes.clear();
+    for (const char *p = text; *p;) {
+        char *end;
+        unsigned long size = strtoul(p, &end, 10);
+        if (end == p || size < 1)
+            return false;
+        sizes.push_back((unsigned)size);
+        p = end;
+        if (*p == ',')
+            ++p;
+        else if (*p)
+            return false;
+    }
+    return !sizes.empty();
+}
+
+static bool parse_sweep_parameter(const char *symbol, int &index)
+{
+    {% if active|length > 0 %}
+    for (unsigned i = 0; i < {{Identifier}}::NumActives; ++i) {
+        if (!std::strcmp(symbol, {{Identifier}}::parameter_symbol(i))) {
+            index = (int)i;
+            return true;
+        }
+    }
+    {% endif %}
+    (void)symbol;
+    (void)index;
+    return false;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "Usage: bench [options]\n"
+            "  -r <rate>      sample rate (48000)\n"
+            "  -b <sizes>     block sizes, separated by commas (16,32,64,128,256,512,1024,2048)\n"
+            "  -d <seconds>   duration of audio for each measure (5)\n"
+            "  -m <mode>      static, sweep or both (both)\n"
+            "  -p <symbol>    sweep only this parameter\n"
+            "  -c             read the counters of the processor\n"
+            "  -C             print the results as CSV\n");
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+
+    for (int c; (c = getopt(argc, argv, "r:b:d:m:p:cCh")) != -1;) {
+        switch (c) {
+        case 'r': options.sample_rate = (unsigned)atoi(optarg); break;
+        case 'b':
+            if (!parse_block_sizes(optarg, options.block_sizes)) { usage(); return 1; }
+            break;
+        case 'd': options.duration = atof(optarg); break;
+        case 'm':
+            options.run_static = !std::strcmp(optarg, "static") || !std::strcmp(optarg, "both");
+            options.run_sweep = !std::strcmp(optarg, "sweep") || !std::strcmp(optarg, "both");
+            if (!options.run_static && !options.run_sweep) { usage(); return 1; }
+            break;
+        case 'p':
+            if (!parse_sweep_parameter(optarg, options.sweep_parameter)) {
+                fprintf(stderr, "There is no parameter `%s`.\n", optarg);
+                return 1;
+            }
+            break;
+        case 'c': options.counters = true; break;
+        case 'C': options.csv = true; break;
+        default: usage(); return 1;
+        }
+    }
+    if (options.sample_rate < 1 || !(options.duration > 0)) {
+        usage();
+        return 1;
+    }
+
+    PerfCounters counters;
+    if (options.counters && !counters.open()) {
+        fprintf(stderr, "Cannot read the counters of the processor, check `perf_event_paranoid`.\n");
+        options.counters = false;
+    }
+
+    print_header(options);
+    for (unsigned block : options.block_sizes) {
+        if (options.run_static) {
+            BenchResult result = measure(options, block, BenchStatic, options.counters ? &counters : nullptr);
+            print_result(options, block, BenchStatic, result);
+        }
+        if (options.run_sweep) {
+            BenchResult result = measure(options, block, BenchSweep, options.counters ? &counters : nullptr);
+            print_result(options, block, BenchSweep, result);
+        }
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,564 @@
+#include "{{Identifier}}.hpp"
+
+//------------------------------------------------------------------------------
+
+#include <clap/clap.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+// A CLAP plugin, which hosts the class generated by `generic` or `oversampled`.
+//
+// The changes of the parameters in the events of a block are applied at their
+// exact frame, by splitting the processing at the time of each event.
+//
+// The plugin may run several instances of the DSP side by side, each on its
+// own channels, for example a mono DSP on the channels of a stereo bus. If the
+// host has a thread pool, the instances are processed as parallel tasks.
+// Each task reads the events by itself, so the tasks share no state.
+
+{% set ClapInstances = ClapInstances|default(1) %}
+{% set ClapFeatures = (ClapFeatures|default("audio-effect" if inputs > 0 else "instrument")).split(",") %}
+
+enum { ClapInstances = {{ClapInstances}} };
+enum { ClapInputChannels = ClapInstances * {{Identifier}}::NumInputs };
+enum { ClapOutputChannels = ClapInstances * {{Identifier}}::NumOutputs };
+enum { ClapNumParameters = {{Identifier}}::NumParameters };
+
+static_assert(ClapInstances >= 1, "The number of instances is invalid.");
+
+//------------------------------------------------------------------------------
+// The values of the parameters
+//
+// CLAP has no logarithmic parameters, so the parameters on a logarithmic scale
+// have a normalized value in the range 0 to 1, which the host can present as a
+// linear knob. Their text shows the real value.
+
+static bool parameter_uses_log(unsigned index)
+{
+    const {{Identifier}}::ParameterRange *range = {{Identifier}}::parameter_range(index);
+    return {{Identifier}}::parameter_is_logarithmic(index) &&
+        range->min > 0 && range->max > range->min;
+}
+
+static float clap_to_plain(unsigned index, double value)
+{
+    if (!parameter_uses_log(index))
+        return (float)value;
+    const {{Identifier}}::ParameterRange *range = {{Identifier}}::parameter_range(index);
+    return (float)(range->min * std::pow((double)range->max / range->min, value));
+}
+
+static double plain_to_clap(unsigned index, float value)
+{
+    if (!parameter_uses_log(index))
+        return value;
+    const {{Identifier}}::ParameterRange *range = {{Identifier}}::parameter_range(index);
+    if (value <= range->min)
+        return 0;
+    return std::log((double)value / range->min) / std::log((double)range->max / range->min);
+}
+
+static bool is_parameter_event(const clap_event_header_t *header)
+{
+    return header->space_id == CLAP_CORE_EVENT_SPACE_ID &&
+        header->type == CLAP_EVENT_PARAM_VALUE &&
+        ((const clap_event_param_value_t *)header)->param_id < {{Identifier}}::NumActives;
+}
+
+//------------------------------------------------------------------------------
+
+struct ClapPlugin {
+    clap_plugin_t plugin;
+    const clap_host_t *host = nullptr;
+    const clap_host_thread_pool_t *host_thread_pool = nullptr;
+    std::unique_ptr<{{Identifier}}> dsp[ClapInstances];
+    // the values seen by the host, as plain values
+    std::atomic<float> values[ClapNumParameters ? ClapNumParameters : 1];
+    // the block in progress, for the tasks of the thread pool
+    const clap_process_t *process = nullptr;
+};
+
+static ClapPlugin *get_plugin(const clap_plugin_t *plugin)
+{
+    return (ClapPlugin *)plugin->plugin_data;
+}
+
+// process one instance on the whole block, splitting at the parameter events
+static void process_instance(ClapPlugin *self, unsigned instance, const clap_process_t *process)
+{
+    {{Identifier}} &dsp = *self->dsp[instance];
+    const clap_input_events_t *events = process->in_events;
+    const uint32_t frames = process->frames_count;
+    const uint32_t count = events->size(events);
+
+    float *const *inputs = ({{Identifier}}::NumInputs > 0) ?
+        process->audio_inputs[0].data32 + instance * {{Identifier}}::NumInputs : nullptr;
+    float *const *outputs = ({{Identifier}}::NumOutputs > 0) ?
+        process->audio_outputs[0].data32 + instance * {{Identifier}}::NumOutputs : nullptr;
+    (void)inputs;
+    (void)outputs;
+
+    uint32_t index = 0;
+    for (uint32_t i = 0; i <= count; ++i) {
+        const clap_event_header_t *header = (i < count) ? events->get(events, i) : nullptr;
+        if (header && !is_parameter_event(header))
+            continue;
+
+        uint32_t time = header ? header->time : frames;
+        if (time > frames)
+            time = frames;
+        if (time > index) {
+            dsp.process(
+                {% for i in range(inputs) %}inputs[{{i}}] + index,{% endfor %}
+                {% for i in range(outputs) %}outputs[{{i}}] + index,{% endfor %}
+                time - index);
+            index = time;
+        }
+
+        if (header) {
+            const clap_event_param_value_t *event = (const clap_event_param_value_t *)header;
+            dsp.set_parameter(event->param_id, clap_to_plain(event->param_id, event->value));
+        }
+    }
+}
+
+// apply the parameter events to all instances, outside of the processing
+static void apply_events(ClapPlugin *self, const clap_input_events_t *events)
+{
+    const uint32_t count = events->size(events);
+    for (uint32_t i = 0; i < count; ++i) {
+        const clap_event_header_t *header = events->get(events, i);
+        if (!is_parameter_event(header))
+            continue;
+        const clap_event_param_value_t *event = (const clap_event_param_value_t *)header;
+        float value = clap_to_plain(event->param_id, event->value);
+        for (unsigned instance = 0; instance < ClapInstances; ++instance)
+            self->dsp[instance]->set_parameter(event->param_id, value);
+        self->values[event->param_id].store(value, std::memory_order_relaxed);
+    }
+}
+
+// report the changes of the passive parameters, which the first instance sets
+static void output_events(ClapPlugin *self, const clap_output_events_t *events)
+{
+    for (unsigned index = {{Identifier}}::NumActives; index < ClapNumParameters; ++index) {
+        float value = self->dsp[0]->get_parameter(index);
+        if (value == self->values[index].load(std::memory_order_relaxed))
+            continue;
+        self->values[index].store(value, std::memory_order_relaxed);
+        if (!events)
+            continue;
+        clap_event_param_value_t event;
+        std::memset(&event, 0, sizeof(event));
+        event.header.size = sizeof(event);
+        event.header.time = 0;
+        event.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+        event.header.type = CLAP_EVENT_PARAM_VALUE;
+        event.header.flags = 0;
+        event.param_id = index;
+        event.cookie = nullptr;
+        event.note_id = -1;
+        event.port_index = -1;
+        event.channel = -1;
+        event.key = -1;
+        event.value = plain_to_clap(index, value);
+        events->try_push(events, &event.header);
+    }
+}
+
+//------------------------------------------------------------------------------
+// The plugin
+
+static bool plugin_init(const clap_plugin_t *plugin)
+{
+    ClapPlugin *self = get_plugin(plugin);
+    self->host_thread_pool = (const clap_host_thread_pool_t *)
+        self->host->get_extension(self->host, CLAP_EXT_THREAD_POOL);
+    return true;
+}
+
+static void plugin_destroy(const clap_plugin_t *plugin)
+{
+    delete get_plugin(plugin);
+}
+
+static bool plugin_activate(const clap_plugin_t *plugin, double sample_rate, uint32_t, uint32_t)
+{
+    ClapPlugin *self = get_plugin(plugin);
+    for (unsigned instance = 0; instance < ClapInstances; ++instance)
+        self->dsp[instance]->init((float)sample_rate);
+    return true;
+}
+
+static void plugin_deactivate(const clap_plugin_t *)
+{
+}
+
+static bool plugin_start_processing(const clap_plugin_t *)
+{
+    return true;
+}
+
+static void plugin_stop_processing(const clap_plugin_t *)
+{
+}
+
+static void plugin_reset(const clap_plugin_t *plugin)
+{
+    ClapPlugin *self = get_plugin(plugin);
+    for (unsigned instance = 0; instance < ClapInstances; ++instance)
+        self->dsp[instance]->clear();
+}
+
+static clap_process_status plugin_process(const clap_plugin_t *plugin, const clap_process_t *process)
+{
+    ClapPlugin *self = get_plugin(plugin);
+
+    if ({{Identifier}}::NumInputs > 0 &&
+        (process->audio_inputs_count < 1 || process->audio_inputs[0].channel_count != ClapInputChannels))
+        return CLAP_PROCESS_ERROR;
+    if ({{Identifier}}::NumOutputs > 0 &&
+        (process->audio_outputs_count < 1 || process->audio_outputs[0].channel_count != ClapOutputChannels))
+        return CLAP_PROCESS_ERROR;
+
+    // the values seen by the host are those at the end of the block
+    const clap_input_events_t *events = process->in_events;
+    const uint32_t count = events->size(events);
+    for (uint32_t i = 0; i < count; ++i) {
+        const clap_event_header_t *header = events->get(events, i);
+        if (!is_parameter_event(header))
+            continue;
+        const clap_event_param_value_t *event = (const clap_event_param_value_t *)header;
+        self->values[event->param_id].store(clap_to_plain(event->param_id, event->value), std::memory_order_relaxed);
+    }
+
+    const clap_host_thread_pool_t *pool = self->host_thread_pool;
+    bool parallel = false;
+    if (ClapInstances > 1 && pool) {
+        self->process = process;
+        parallel = pool->request_exec(self->host, ClapInstances);
+        self->process = nullptr;
+    }
+    if (!parallel) {
+        for (unsigned instance = 0; instance < ClapInstances; ++instance)
+            process_instance(self, instance, process);
+    }
+
+    output_events(self, process->out_events);
+    return CLAP_PROCESS_CONTINUE;
+}
+
+//------------------------------------------------------------------------------
+// The extensions
+
+static uint32_t params_count(const clap_plugin_t *)
+{
+    return ClapNumParameters;
+}
+
+static bool params_get_info(const clap_plugin_t *, uint32_t index, clap_param_info_t *info)
+{
+    if (index >= ClapNumParameters)
+        return false;
+
+    std::memset(info, 0, sizeof(*info));
+    info->id = index;
+    info->cookie = nullptr;
+    std::snprintf(info->name, sizeof(info->name), "%s", {{Identifier}}::parameter_label(index));
+    info->module[0] = '\0';
+
+    clap_param_info_flags flags = 0;
+    if (index < {{Identifier}}::NumActives)
+        flags |= CLAP_PARAM_IS_AUTOMATABLE;
+    else
+        flags |= CLAP_PARAM_IS_READONLY;
+    if ({{Identifier}}::parameter_is_integer(index))
+        flags |= CLAP_PARAM_IS_STEPPED;
+    info->flags = flags;
+
+    const {{Identifier}}::ParameterRange *range = {{Identifier}}::parameter_range(index);
+    if (parameter_uses_log(index)) {
+        info->min_value = 0;
+        info->max_value = 1;
+    }
+    else {
+        info->min_value = range->min;
+        info->max_value = range->max;
+    }
+    info->default_value = plain_to_clap(index, range->init);
+    return true;
+}
+
+static bool params_get_value(const clap_plugin_t *plugin, clap_id id, double *value)
+{
+    if (id >= ClapNumParameters)
+        return false;
+    ClapPlugin *self = get_plugin(plugin);
+    *value = plain_to_clap(id, self->values[id].load(std::memory_order_relaxed));
+    return true;
+}
+
+static bool params_value_to_text(const clap_plugin_t *, clap_id id, double value, char *text, uint32_t capacity)
+{
+    if (id >= ClapNumParameters || capacity < 1)
+        return false;
+    const char *unit = {{Identifier}}::parameter_unit(id);
+    float plain = clap_to_plain(id, value);
+    if ({{Identifier}}::parameter_is_integer(id))
+        std::snprintf(text, capacity, "%ld%s%s", std::lround(plain), unit[0] ? " " : "", unit);
+    else
+        std::snprintf(text, capacity, "%g%s%s", plain, unit[0] ? " " : "", unit);
+    return true;
+}
+
+static bool params_text_to_value(const clap_plugin_t *, clap_id id, const char *text, double *value)
+{
+    if (id >= ClapNumParameters)
+        return false;
+    char *end;
+    double plain = std::strtod(text, &end);
+    if (end == text)
+        return false;
+    *value = plain_to_clap(id, (float)plain);
+    return true;
+}
+
+static void params_flush(const clap_plugin_t *plugin, const clap_input_events_t *in, const clap_output_events_t *out)
+{
+    ClapPlugin *self = get_plugin(plugin);
+    apply_events(self, in);
+    output_events(self, out);
+}
+
+static const clap_plugin_params_t params_extension = {
+    &params_count,
+    &params_get_info,
+    &params_get_value,
+    &params_value_to_text,
+    &params_text_to_value,
+    &params_flush,
+};
+
+static uint32_t audio_ports_count(const clap_plugin_t *, bool is_input)
+{
+    unsigned channels = is_input ? (unsigned)ClapInputChannels : (unsigned)ClapOutputChannels;
+    return channels > 0;
+}
+
+static bool audio_ports_get(const clap_plugin_t *, uint32_t index, bool is_input, clap_audio_port_info_t *info)
+{
+    if (index >= audio_ports_count(nullptr, is_input))
+        return false;
+
+    uint32_t channels = is_input ? (uint32_t)ClapInputChannels : (uint32_t)ClapOutputChannels;
+    std::memset(info, 0, sizeof(*info));
+    info->id = 0;
+    std::snprintf(info->name, sizeof(info->name), "%s", is_input ? "Input" : "Output");
+    info->flags = CLAP_AUDIO_PORT_IS_MAIN;
+    info->channel_count = channels;
+    info->port_type = (channels == 1) ? CLAP_PORT_MONO : (channels == 2) ? CLAP_PORT_STEREO : nullptr;
+    info->in_place_pair = CLAP_INVALID_ID;
+    return true;
+}
+
+static const clap_plugin_audio_ports_t audio_ports_extension = {
+    &audio_ports_count,
+    &audio_ports_get,
+};
+
+static uint32_t latency_get(const clap_plugin_t *plugin)
+{
+    ClapPlugin *self = get_plugin(plugin);
+    return (uint32_t)std::lround(self->dsp[0]->latency());
+}
+
+static const clap_plugin_latency_t latency_extension = {
+    &latency_get,
+};
+
+static void thread_pool_exec(const clap_plugin_t *plugin, uint32_t task)
+{
+    ClapPlugin *self = get_plugin(plugin);
+    if (task < ClapInstances && self->process)
+        process_instance(self, task, self->process);
+}
+
+static const clap_plugin_thread_pool_t thread_pool_extension = {
+    &thread_pool_exec,
+};
+
+// the state is a text of lines `symbol=value`, so it survives a change of the
+// order of the parameters
+static bool state_save(const clap_plugin_t *plugin, const clap_ostream_t *stream)
+{
+    ClapPlugin *self = get_plugin(plugin);
+    std::string text;
+    for (unsigned index = 0; index < {{Identifier}}::NumActives; ++index) {
+        char value[64];
+        std::snprintf(value, sizeof(value), "%.9g", self->values[index].load(std::memory_order_relaxed));
+        text.append({{Identifier}}::parameter_symbol(index));
+        text.push_back('=');
+        text.append(value);
+        text.push_back('\n');
+    }
+    for (size_t written = 0; written < text.size();) {
+        int64_t result = stream->write(stream, text.data() + written, text.size() - written);
+        if (result <= 0)
+            return false;
+        written += (size_t)result;
+    }
+    return true;
+}
+
+static bool state_load(const clap_plugin_t *plugin, const clap_istream_t *stream)
+{
+    ClapPlugin *self = get_plugin(plugin);
+    std::string text;
+    char buffer[256];
+    for (int64_t result; (result = stream->read(stream, buffer, sizeof(buffer))) != 0;) {
+        if (result < 0)
+            return false;
+        text.append(buffer, (size_t)result);
+    }
+
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos)
+            end = text.size();
+        std::string line = text.substr(start, end - start);
+        start = end + 1;
+        size_t equal = line.find('=');
+        if (equal == std::string::npos)
+            continue;
+        std::string symbol = line.substr(0, equal);
+        float value = std::strtof(line.c_str() + equal + 1, nullptr);
+        for (unsigned index = 0; index < {{Identifier}}::NumActives; ++index) {
+            if (symbol != {{Identifier}}::parameter_symbol(index))
+                continue;
+            for (unsigned instance = 0; instance < ClapInstances; ++instance)
+                self->dsp[instance]->set_parameter(index, value);
+            self->values[index].store(value, std::memory_order_relaxed);
+        }
+    }
+    return true;
+}
+
+static const clap_plugin_state_t state_extension = {
+    &state_save,
+    &state_load,
+};
+
+static const void *plugin_get_extension(const clap_plugin_t *, const char *id)
+{
+    if (!std::strcmp(id, CLAP_EXT_PARAMS))
+        return &params_extension;
+    if (!std::strcmp(id, CLAP_EXT_AUDIO_PORTS))
+        return &audio_ports_extension;
+    if (!std::strcmp(id, CLAP_EXT_LATENCY))
+        return &latency_extension;
+    if (!std::strcmp(id, CLAP_EXT_STATE))
+        return &state_extension;
+    if (ClapInstances > 1 && !std::strcmp(id, CLAP_EXT_THREAD_POOL))
+        return &thread_pool_extension;
+    return nullptr;
+}
+
+static void plugin_on_main_thread(const clap_plugin_t *)
+{
+}
+
+//------------------------------------------------------------------------------
+// The factory and the entry
+
+static const char *const plugin_features[] = {
+    {% for feature in ClapFeatures %}
+    {{cstr(feature|trim)}},
+    {% endfor %}
+    nullptr,
+};
+
+static const clap_plugin_descriptor_t plugin_descriptor = {
+    CLAP_VERSION_INIT,
+    {{cstr(ClapId|default("faustpp." ~ Identifier))}},
+    {{cstr(name or Identifier)}},
+    {{cstr(author or "")}},
+    {{cstr(meta.url|default(""))}},
+    "",
+    "",
+    {{cstr(version or "")}},
+    {{cstr(meta.description|default(""))}},
+    plugin_features,
+};
+
+static uint32_t factory_get_plugin_count(const clap_plugin_factory_t *)
+{
+    return 1;
+}
+
+static const clap_plugin_descriptor_t *factory_get_plugin_descriptor(const clap_plugin_factory_t *, uint32_t index)
+{
+    return (index == 0) ? &plugin_descriptor : nullptr;
+}
+
+static const clap_plugin_t *factory_create_plugin(const clap_plugin_factory_t *, const clap_host_t *host, const char *plugin_id)
+{
+    if (!clap_version_is_compatible(host->clap_version) || std::strcmp(plugin_id, plugin_descriptor.id))
+        return nullptr;
+
+    ClapPlugin *self = new ClapPlugin;
+    self->host = host;
+    for (unsigned instance = 0; instance < ClapInstances; ++instance)
+        self->dsp[instance].reset(new {{Identifier}});
+    for (unsigned index = 0; index < ClapNumParameters; ++index)
+        self->values[index].store(self->dsp[0]->get_parameter(index), std::memory_order_relaxed);
+
+    clap_plugin_t &plugin = self->plugin;
+    plugin.desc = &plugin_descriptor;
+    plugin.plugin_data = self;
+    plugin.init = &plugin_init;
+    plugin.destroy = &plugin_destroy;
+    plugin.activate = &plugin_activate;
+    plugin.deactivate = &plugin_deactivate;
+    plugin.start_processing = &plugin_start_processing;
+    plugin.stop_processing = &plugin_stop_processing;
+    plugin.reset = &plugin_reset;
+    plugin.process = &plugin_process;
+    plugin.get_extension = &plugin_get_extension;
+    plugin.on_main_thread = &plugin_on_main_thread;
+    return &plugin;
+}
+
+static const clap_plugin_factory_t plugin_factory = {
+    &factory_get_plugin_count,
+    &factory_get_plugin_descriptor,
+    &factory_create_plugin,
+};
+
+static bool entry_init(const char *)
+{
+    return true;
+}
+
+static void entry_deinit()
+{
+}
+
+static const void *entry_get_factory(const char *factory_id)
+{
+    if (!std::strcmp(factory_id, CLAP_PLUGIN_FACTORY_ID))
+        return &plugin_factory;
+    return nullptr;
+}
+
+extern "C" CLAP_EXPORT const clap_plugin_entry_t clap_entry = {
+    CLAP_VERSION_INIT,
+    &entry_init,
+    &entry_deinit,
+    &entry_get_factory,
+};
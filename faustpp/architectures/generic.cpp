@@ -26,6 +26,89 @@
 {% endblock %}
 #include <utility>
 #include <cmath>
+{% if Pipelined|default(0) %}
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <climits>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+#include <unistd.h>
+{% endif %}
+{% if RealtimeSanitizer|default(0) %}
+#include <atomic>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/select.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+{% include "realtime_sanitizer.inc" %}
+
+{{Identifier}}::RealtimeGuard::RealtimeGuard(const char *scope) noexcept
+{
+    faustpp_rtsan_enter(scope);
+}
+
+{{Identifier}}::RealtimeGuard::~RealtimeGuard()
+{
+    faustpp_rtsan_leave();
+}
+{% endif %}
+{% if Trace|default(0) %}
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+{% include "trace.inc" %}
+
+{{Identifier}}::TraceScope::TraceScope(const char *name, unsigned instance, unsigned value) noexcept
+    : fName(name), fInstance(instance), fValue(value), fBegin(trace_now())
+{
+}
+
+{{Identifier}}::TraceScope::~TraceScope()
+{
+    faustpp_trace_record(fName, fInstance, fValue, fBegin, trace_now());
+}
+
+unsigned {{Identifier}}::trace_instance() const noexcept
+{
+    return fTraceInstance;
+}
+
+void {{Identifier}}::trace_register_thread()
+{
+    faustpp_trace_register_thread(TraceCapacity);
+}
+
+bool {{Identifier}}::trace_dump(const char *path)
+{
+    return faustpp_trace_dump(path);
+}
+
+void {{Identifier}}::trace_clear() noexcept
+{
+    faustpp_trace_clear();
+}
+{% endif %}
 
 class {{Identifier}}::BasicDsp {
 public:
@@ -82,22 +165,148 @@ typedef {{Identifier}}::BasicDsp dsp;
 
 {% block ImplementationBeforeClassDefs %}
 {% endblock %}
+{% if Pipelined|default(0) %}
+
+//------------------------------------------------------------------------------
+// The pipelined processing. A worker thread processes each block, while the
+// caller gets the result of the block before, so the processing can take up to
+// a whole period on another core, at the cost of a block of latency.
+// The block is exchanged in one of two slots, without locking. The threads
+// wait for each other by spinning for a while, and then by a futex.
+
+static constexpr unsigned PipelineFrames = {{PipelineFrames|default(4096)}};
+
+namespace {
+
+inline void futex_wait(std::atomic<uint32_t> &word, uint32_t value) noexcept
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, value, nullptr, nullptr, 0);
+}
+
+inline void futex_wake(std::atomic<uint32_t> &word) noexcept
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+} // namespace
+
+struct {{Identifier}}::Pipeline {
+    struct Slot {
+        float inputs[{{[inputs, 1]|max}}][PipelineFrames];
+        float outputs[{{[outputs, 1]|max}}][PipelineFrames];
+    };
+
+    explicit Pipeline({{Identifier}} *self);
+    ~Pipeline();
+    void run() noexcept;
+    void wait_completed() noexcept;
+
+    {{Identifier}} *fSelf = nullptr;
+    Slot fSlots[2];
+    // the state of the caller
+    unsigned fFrames = 0;
+    bool fFilled = false;
+    uint32_t fSequence = 0;
+    // the state shared with the worker
+    std::atomic<unsigned> fLatency{0};
+    std::atomic<uint32_t> fRequested{0};
+    std::atomic<uint32_t> fCompleted{0};
+    std::atomic<bool> fQuit{false};
+    std::thread fThread;
+};
+
+{{Identifier}}::Pipeline::Pipeline({{Identifier}} *self)
+    : fSelf(self)
+{
+    std::memset(fSlots, 0, sizeof(fSlots));
+    fThread = std::thread([this]() { run(); });
+
+    // the worker is realtime, if permitted
+    sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    param.sched_priority = {{PipelinePriority|default(60)}};
+    pthread_setschedparam(fThread.native_handle(), SCHED_FIFO, &param);
+}
+
+{{Identifier}}::Pipeline::~Pipeline()
+{
+    fQuit.store(true, std::memory_order_release);
+    fRequested.fetch_add(1, std::memory_order_release);
+    futex_wake(fRequested);
+    fThread.join();
+}
+
+void {{Identifier}}::Pipeline::run() noexcept
+{
+    uint32_t done = fCompleted.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t request;
+        while ((request = fRequested.load(std::memory_order_acquire)) == done)
+            futex_wait(fRequested, done);
+        if (fQuit.load(std::memory_order_acquire))
+            break;
+        Slot &slot = fSlots[request % 2];
+        fSelf->process_block(
+            {% for i in range(inputs) %}slot.inputs[{{i}}],{% endfor %}
+            {% for i in range(outputs) %}slot.outputs[{{i}}],{% endfor %}
+            fFrames);
+        done = request;
+        fCompleted.store(done, std::memory_order_release);
+        futex_wake(fCompleted);
+    }
+}
+
+void {{Identifier}}::Pipeline::wait_completed() noexcept
+{
+    uint32_t completed;
+    unsigned spins = 0;
+    while ((completed = fCompleted.load(std::memory_order_acquire)) != fSequence) {
+        if (spins < 4096)
+            ++spins;
+        else
+            futex_wait(fCompleted, completed);
+    }
+}
+{% endif %}
+
+#if __cplusplus < 201703L
+constexpr std::size_t {{Identifier}}::StateBytes;
+constexpr std::size_t {{Identifier}}::DelayBytes;
+constexpr std::size_t {{Identifier}}::TableBytes;
+constexpr std::size_t {{Identifier}}::OpsPerSample;
+constexpr std::size_t {{Identifier}}::CallsPerSample;
+#endif
 
 {{Identifier}}::{{Identifier}}()
 {
+{% if Trace|default(0) %}
+    faustpp_trace_setup();
+    faustpp_trace_register_thread(TraceCapacity);
+    fTraceInstance = faustpp_trace_next_instance();
+{% endif %}
 {% block ImplementationSetupDsp %}
     {{class_name}} *dsp = new {{class_name}};
     fDsp.reset(dsp);
     dsp->instanceResetUserInterface();
 {% endblock %}
+{% if Pipelined|default(0) %}
+    fPipeline.reset(new Pipeline(this));
+{% endif %}
 }
 
 {{Identifier}}::~{{Identifier}}()
 {
+{% if Pipelined|default(0) %}
+    fPipeline.reset();
+{% endif %}
 }
 
 void {{Identifier}}::init(float sample_rate)
 {
+{% if Trace|default(0) %}
+    faustpp_trace_register_thread(TraceCapacity);
+    TraceScope trace("{{Identifier}}::init", fTraceInstance);
+{% endif %}
 {% block ImplementationInitDsp %}
     {{class_name}} &dsp = static_cast<{{class_name}} &>(*fDsp);
     dsp.classInit(sample_rate);
@@ -108,17 +317,91 @@ void {{Identifier}}::init(float sample_rate)
 
 void {{Identifier}}::clear() noexcept
 {
+{% if Trace|default(0) %}
+    TraceScope trace("{{Identifier}}::clear", fTraceInstance);
+{% endif %}
+{% if Pipelined|default(0) %}
+    fPipeline->wait_completed();
+    fPipeline->fFilled = false;
+{% endif %}
 {% block ImplementationClearDsp %}
     {{class_name}} &dsp = static_cast<{{class_name}} &>(*fDsp);
     dsp.instanceClear();
 {% endblock %}
 }
 
+{% if Pipelined|default(0) %}
 void {{Identifier}}::process(
     {% for i in range(inputs) %}const float *in{{i}},{% endfor %}
     {% for i in range(outputs) %}float *out{{i}},{% endfor %}
     unsigned count) noexcept
 {
+{% if Trace|default(0) %}
+    TraceScope trace("{{Identifier}}::process", fTraceInstance, count);
+{% endif %}
+{% if RealtimeSanitizer|default(0) %}
+    RealtimeGuard guard("{{Identifier}}::process");
+{% endif %}
+    Pipeline &pipeline = *fPipeline;
+
+    // the block size changes, restart the pipeline
+    if (count != pipeline.fFrames) {
+        pipeline.wait_completed();
+        pipeline.fFilled = false;
+        pipeline.fFrames = (count <= PipelineFrames) ? count : 0;
+        pipeline.fLatency.store(pipeline.fFrames, std::memory_order_relaxed);
+    }
+
+    // the block is too large for the pipeline, process it directly
+    if (pipeline.fFrames == 0) {
+        process_block(
+            {% for i in range(inputs) %}in{{i}},{% endfor %}
+            {% for i in range(outputs) %}out{{i}},{% endfor %}
+            count);
+        return;
+    }
+
+    uint32_t sequence = pipeline.fSequence + 1;
+    {% if inputs > 0 %}
+    Pipeline::Slot &next = pipeline.fSlots[sequence % 2];
+    {% endif %}
+    {% for i in range(inputs) %}
+    std::memcpy(next.inputs[{{i}}], in{{i}}, count * sizeof(float));
+    {% endfor %}
+
+    if (pipeline.fFilled) {
+        pipeline.wait_completed();
+        {% if outputs > 0 %}
+        Pipeline::Slot &previous = pipeline.fSlots[(sequence - 1) % 2];
+        {% endif %}
+        {% for i in range(outputs) %}
+        std::memcpy(out{{i}}, previous.outputs[{{i}}], count * sizeof(float));
+        {% endfor %}
+    }
+    else {
+        {% for i in range(outputs) %}
+        std::memset(out{{i}}, 0, count * sizeof(float));
+        {% endfor %}
+    }
+
+    pipeline.fSequence = sequence;
+    pipeline.fFilled = true;
+    pipeline.fRequested.store(sequence, std::memory_order_release);
+    futex_wake(pipeline.fRequested);
+}
+
+{% endif %}
+void {{Identifier}}::{{"process_block" if Pipelined|default(0) else "process"}}(
+    {% for i in range(inputs) %}const float *in{{i}},{% endfor %}
+    {% for i in range(outputs) %}float *out{{i}},{% endfor %}
+    unsigned count) noexcept
+{
+{% if Trace|default(0) %}
+    TraceScope trace("{{Identifier}}::{{"process_block" if Pipelined|default(0) else "process"}}", fTraceInstance, count);
+{% endif %}
+{% if RealtimeSanitizer|default(0) %}
+    RealtimeGuard guard("{{Identifier}}::process");
+{% endif %}
 {% block ImplementationProcessDsp %}
     {{class_name}} &dsp = static_cast<{{class_name}} &>(*fDsp);
     float *inputs[] = {
@@ -131,6 +414,20 @@ void {{Identifier}}::process(
 {% endblock %}
 }
 
+{% if Pipelined|default(0) %}
+float {{Identifier}}::latency() const noexcept
+{
+    return block_latency() + fPipeline->fLatency.load(std::memory_order_relaxed);
+}
+
+{% endif %}
+float {{Identifier}}::{{"block_latency" if Pipelined|default(0) else "latency"}}() const noexcept
+{
+{% block ImplementationLatency %}
+    return 0;
+{% endblock %}
+}
+
 const char *{{Identifier}}::parameter_label(unsigned index) noexcept
 {
     switch (index) {
@@ -247,6 +544,7 @@ bool {{Identifier}}::parameter_is_logarithmic(unsigned index) noexcept
 
 float {{Identifier}}::get_parameter(unsigned index) const noexcept
 {
+{% block ImplementationGetParameter %}
     {{class_name}} &dsp = static_cast<{{class_name}} &>(*fDsp);
     switch (index) {
     {% for w in active + passive %}
@@ -257,10 +555,18 @@ float {{Identifier}}::get_parameter(unsigned index) const noexcept
         (void)dsp;
         return 0;
     }
+{% endblock %}
 }
 
 void {{Identifier}}::set_parameter(unsigned index, float value) noexcept
 {
+{% if Trace|default(0) %}
+    TraceScope trace("{{Identifier}}::set_parameter", fTraceInstance, index);
+{% endif %}
+{% if RealtimeSanitizer|default(0) %}
+    RealtimeGuard guard("{{Identifier}}::set_parameter");
+{% endif %}
+{% block ImplementationSetParameter %}
     {{class_name}} &dsp = static_cast<{{class_name}} &>(*fDsp);
     switch (index) {
     {% for w in active %}
@@ -273,20 +579,28 @@ void {{Identifier}}::set_parameter(unsigned index, float value) noexcept
         (void)value;
         break;
     }
+{% endblock %}
 }
 
 {% for w in active + passive %}
 float {{Identifier}}::get_{{cid(w.meta.symbol|default(w.label))}}() const noexcept
 {
+{% block ImplementationGetWidget scoped %}
     {{class_name}} &dsp = static_cast<{{class_name}} &>(*fDsp);
     return dsp.{{w.var}};
+{% endblock %}
 }
 {% endfor %}
 {% for w in active %}
 void {{Identifier}}::set_{{cid(w.meta.symbol|default(w.label))}}(float value) noexcept
 {
+{% if Trace|default(0) %}
+    TraceScope trace("{{Identifier}}::set_parameter", fTraceInstance, {{loop.index0}});
+{% endif %}
+{% block ImplementationSetWidget scoped %}
     {{class_name}} &dsp = static_cast<{{class_name}} &>(*fDsp);
     dsp.{{w.var}} = value;
+{% endblock %}
 }
 {% endfor %}
 
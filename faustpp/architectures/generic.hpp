@@ -24,6 +24,10 @@
 #define {{Identifier}}_Faust_pp_Gen_HPP_
 
 #include <memory>
+#include <cstddef>
+{% if Trace|default(0) %}
+#include <cstdint>
+{% endif %}
 
 class {{Identifier}} {
 public:
@@ -38,12 +42,24 @@ public:
         {% for i in range(outputs) %}float *out{{i}},{% endfor %}
         unsigned count) noexcept;
 
+    float latency() const noexcept;
+
     enum { NumInputs = {{inputs}} };
     enum { NumOutputs = {{outputs}} };
     enum { NumActives = {{active|length}} };
     enum { NumPassives = {{passive|length}} };
     enum { NumParameters = {{active|length + passive|length}} };
 
+{% block ClassCapacityDecls %}
+    // the estimates of the resources of the Faust code, per instance, except
+    // the tables which are shared, and per frame for the operations
+    static constexpr std::size_t StateBytes = {{capacity.state_bytes}};
+    static constexpr std::size_t DelayBytes = {{capacity.delay_bytes}};
+    static constexpr std::size_t TableBytes = {{capacity.table_bytes}};
+    static constexpr std::size_t OpsPerSample = {{capacity.ops_per_sample}};
+    static constexpr std::size_t CallsPerSample = {{capacity.calls_per_sample}};
+
+{% endblock %}
     enum Parameter {
         {% for w in active + passive %}p_{{cid(w.meta.symbol|default(w.label))}},
         {% endfor %}
@@ -75,11 +91,70 @@ public:
     void set_{{cid(w.meta.symbol|default(w.label))}}(float value) noexcept;
     {% endfor %}
 
+{% if RealtimeSanitizer|default(0) %}
+    // marks a realtime context, such as the callback of a host, inside which
+    // the sanitizer reports the allocations, the locks and the blocking calls
+    class RealtimeGuard {
+    public:
+        explicit RealtimeGuard(const char *scope) noexcept;
+        ~RealtimeGuard();
+        RealtimeGuard(const RealtimeGuard &) = delete;
+        RealtimeGuard &operator=(const RealtimeGuard &) = delete;
+    };
+
+{% endif %}
+{% if Trace|default(0) %}
+    // records the time spent in a scope, such as the callback of a host, into
+    // the trace which is common to all the generated classes of the program
+    class TraceScope {
+    public:
+        explicit TraceScope(const char *name, unsigned instance = 0, unsigned value = 0) noexcept;
+        ~TraceScope();
+        TraceScope(const TraceScope &) = delete;
+        TraceScope &operator=(const TraceScope &) = delete;
+
+    private:
+        const char *fName;
+        unsigned fInstance;
+        unsigned fValue;
+        uint64_t fBegin;
+    };
+
+    enum { TraceCapacity = {{TraceCapacity|default(65536)}} };
+
+    // the number which identifies this instance in the trace
+    unsigned trace_instance() const noexcept;
+
+    // allocate the buffer of the calling thread, which is done for the thread
+    // which constructs or initializes the instance; a host calls it from its
+    // other threads before they record, such as from the callback which
+    // starts its audio thread, otherwise their records are dropped
+    static void trace_register_thread();
+
+    // write the trace in the JSON format of Chrome, or forget the records
+    static bool trace_dump(const char *path);
+    static void trace_clear() noexcept;
+
+{% endif %}
 public:
     class BasicDsp;
 
 private:
     std::unique_ptr<BasicDsp> fDsp;
+{% if Trace|default(0) %}
+    unsigned fTraceInstance = 0;
+{% endif %}
+
+{% if Pipelined|default(0) %}
+    void process_block(
+        {% for i in range(inputs) %}const float *in{{i}},{% endfor %}
+        {% for i in range(outputs) %}float *out{{i}},{% endfor %}
+        unsigned count) noexcept;
+    float block_latency() const noexcept;
+
+    struct Pipeline;
+    std::unique_ptr<Pipeline> fPipeline;
+{% endif %}
 
 {% block ClassExtraDecls %}
 {% endblock %}
@@ -0,0 +1,79 @@
+#include "{{Identifier}}.hpp"
+
+//------------------------------------------------------------------------------
+
+#include <jack/jack.h>
+#include <cstdio>
+
+// This is an internal client, to be loaded in the process of the JACK server,
+// for example using the command `jack_load`. The processing runs directly in
+// the realtime thread of the server, without waking up another process.
+
+struct JackAudioContext {
+    jack_client_t *client;
+    jack_port_t *port_in[{{inputs}}];
+    jack_port_t *port_out[{{outputs}}];
+    {{Identifier}} dsp;
+};
+
+static int process(jack_nframes_t count, void *userdata)
+{
+    JackAudioContext *jack = (JackAudioContext *)userdata;
+    jack->dsp.process(
+        {% for i in range(inputs) %}(float *)jack_port_get_buffer(jack->port_in[{{i}}], count),{% endfor %}
+        {% for i in range(outputs) %}(float *)jack_port_get_buffer(jack->port_out[{{i}}], count),{% endfor %}
+        count);
+    return 0;
+}
+
+extern "C" int jack_initialize(jack_client_t *client, const char *load_init)
+{
+    (void)load_init;
+
+    JackAudioContext *jack = new JackAudioContext;
+    jack->client = client;
+
+    {% if inputs > 0 %}
+    if (!(
+        {% for i in range(inputs) %}
+        (jack->port_in[{{i}}] = jack_port_register(client, "in_{{i}}", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0))
+        {% if not loop.last %}&&{% endif %}
+        {% endfor %})) {
+        fprintf(stderr, "Cannot register JACK inputs.\n");
+        delete jack;
+        return 1;
+    }
+    {% endif %}
+
+    {% if outputs > 0 %}
+    if (!(
+        {% for i in range(outputs) %}
+        (jack->port_out[{{i}}] = jack_port_register(client, "out_{{i}}", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0))
+        {% if not loop.last %}&&{% endif %}
+        {% endfor %})) {
+        fprintf(stderr, "Cannot register JACK outputs.\n");
+        delete jack;
+        return 1;
+    }
+    {% endif %}
+
+    jack_set_process_callback(client, &process, jack);
+
+    jack->dsp.init(jack_get_sample_rate(client));
+
+    if (jack_activate(client) != 0) {
+        fprintf(stderr, "Cannot activate JACK client.\n");
+        delete jack;
+        return 1;
+    }
+
+    return 0;
+}
+
+// the server has deactivated and closed the client when it calls this,
+// with the argument of the process callback
+extern "C" void jack_finish(void *arg)
+{
+    JackAudioContext *jack = (JackAudioContext *)arg;
+    delete jack;
+}
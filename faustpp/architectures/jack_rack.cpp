@@ -0,0 +1,471 @@
+#include "{{Identifier}}.hpp"
+
+//------------------------------------------------------------------------------
+
+#include <jack/jack.h>
+#include <jack/thread.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+{% if RealtimeHardening|default(0) %}
+#include <sys/mman.h>
+{% endif %}
+#include <unistd.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+// A rack of instances, connected into a directed acyclic graph.
+//
+// The instances without predecessors take the inputs of the client, the others
+// take the sum of the outputs of their predecessors, channel by channel.
+// The instances without successors are summed to the outputs of the client.
+//
+// Each period, the instances are scheduled on a pool of realtime threads,
+// which pick the instances as they become ready, from a work-stealing deque
+// of their own, or else from the others. The sums are always made in the order
+// of the instance numbers, so the result does not depend on the scheduling.
+
+enum { RackFrames = 1024 };
+
+// A deque which is pushed and popped at the bottom by its owner thread, and
+// stolen at the top by the other threads, without locking.
+// (Chase and Lev, with the memory ordering of Lê et al.)
+class RackDeque {
+public:
+    explicit RackDeque(unsigned capacity)
+    {
+        unsigned size = 1;
+        while (size < capacity)
+            size *= 2;
+        fMask = size - 1;
+        fItems.reset(new std::atomic<unsigned>[size]);
+    }
+
+    void push(unsigned item) noexcept
+    {
+        int64_t b = fBottom.load(std::memory_order_relaxed);
+        fItems[b & fMask].store(item, std::memory_order_relaxed);
+        fBottom.store(b + 1, std::memory_order_release);
+    }
+
+    bool pop(unsigned &item) noexcept
+    {
+        int64_t b = fBottom.load(std::memory_order_relaxed) - 1;
+        fBottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = fTop.load(std::memory_order_relaxed);
+        if (t > b) {
+            fBottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        item = fItems[b & fMask].load(std::memory_order_relaxed);
+        if (t == b) {
+            bool won = fTop.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            fBottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    bool steal(unsigned &item) noexcept
+    {
+        int64_t t = fTop.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = fBottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+        item = fItems[t & fMask].load(std::memory_order_relaxed);
+        return fTop.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+private:
+    // the ends are on separate cache lines, against false sharing
+    std::atomic<int64_t> fTop{0};
+    char fPadding[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> fBottom{0};
+    std::unique_ptr<std::atomic<unsigned>[]> fItems;
+    unsigned fMask = 0;
+};
+
+struct RackNode {
+    {{Identifier}} dsp;
+    std::vector<unsigned> predecessors;
+    std::vector<unsigned> successors;
+    std::atomic<unsigned> pending{0};
+    float input[{{[inputs, 1]|max}}][RackFrames];
+    float output[{{[outputs, 1]|max}}][RackFrames];
+};
+
+struct JackRack;
+
+struct RackWorker {
+    JackRack *rack = nullptr;
+    unsigned index = 0;
+    jack_native_thread_t thread;
+    sem_t wake;
+};
+
+struct JackRack {
+    jack_client_t *client = nullptr;
+    jack_port_t *port_in[{{[inputs, 1]|max}}];
+    jack_port_t *port_out[{{[outputs, 1]|max}}];
+
+    std::vector<std::unique_ptr<RackNode>> nodes;
+    std::vector<unsigned> sources;
+    std::vector<unsigned> sinks;
+
+    std::vector<std::unique_ptr<RackDeque>> deques;
+    std::vector<std::unique_ptr<RackWorker>> workers;
+    std::atomic<unsigned> done{0};
+    std::atomic<bool> quit{false};
+
+    // the segment of the current period
+    const float *segment_in[{{[inputs, 1]|max}}];
+    unsigned segment_frames = 0;
+};
+
+static void run_node(JackRack &rack, unsigned worker, unsigned index) noexcept
+{
+    RackNode &node = *rack.nodes[index];
+    unsigned count = rack.segment_frames;
+
+    {% if inputs > 0 %}
+    const float *inputs[{{inputs}}];
+    for (unsigned c = 0; c < {{inputs}}; ++c) {
+        if (node.predecessors.empty()) {
+            inputs[c] = rack.segment_in[c];
+            continue;
+        }
+        float *sum = node.input[c];
+        std::fill(sum, sum + count, 0.0f);
+        {% if outputs > 0 %}
+        for (unsigned p : node.predecessors) {
+            {% if inputs > outputs %}
+            // the inputs beyond the outputs of the predecessors are silent
+            if (c >= {{outputs}})
+                break;
+            {% endif %}
+            const float *x = rack.nodes[p]->output[c];
+            for (unsigned i = 0; i < count; ++i)
+                sum[i] += x[i];
+        }
+        {% endif %}
+        inputs[c] = sum;
+    }
+    {% endif %}
+
+    node.dsp.process(
+        {% for i in range(inputs) %}inputs[{{i}}],{% endfor %}
+        {% for i in range(outputs) %}node.output[{{i}}],{% endfor %}
+        count);
+
+    for (unsigned s : node.successors) {
+        if (rack.nodes[s]->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            rack.deques[worker]->push(s);
+    }
+
+    rack.done.fetch_add(1, std::memory_order_release);
+}
+
+static void run_work(JackRack &rack, unsigned worker) noexcept
+{
+    const unsigned total = (unsigned)rack.nodes.size();
+    const unsigned nworkers = (unsigned)rack.deques.size();
+
+    unsigned idle = 0;
+    while (rack.done.load(std::memory_order_acquire) != total) {
+        unsigned item;
+        bool found = rack.deques[worker]->pop(item);
+        for (unsigned k = 1; !found && k < nworkers; ++k)
+            found = rack.deques[(worker + k) % nworkers]->steal(item);
+        if (found) {
+            run_node(rack, worker, item);
+            idle = 0;
+        }
+        else if (++idle == 64) {
+            // let the other threads run, if there are more than the cores
+            sched_yield();
+            idle = 0;
+        }
+    }
+}
+
+static void run_period(JackRack &rack, unsigned count) noexcept
+{
+    rack.segment_frames = count;
+
+    for (std::unique_ptr<RackNode> &node : rack.nodes)
+        node->pending.store((unsigned)node->predecessors.size(), std::memory_order_relaxed);
+    rack.done.store(0, std::memory_order_relaxed);
+
+    // the thread of JACK is the worker 0, it starts with the sources
+    for (unsigned index : rack.sources)
+        rack.deques[0]->push(index);
+    for (std::unique_ptr<RackWorker> &worker : rack.workers)
+        sem_post(&worker->wake);
+
+    run_work(rack, 0);
+}
+
+{% if RealtimeHardening|default(0) %}
+{% include "realtime_hardening.inc" %}
+
+static void warm_up(JackRack &rack)
+{
+    for (std::unique_ptr<RackNode> &node : rack.nodes)
+        warm_up_dsp(node->dsp, node->input[0], node->output[0], RackFrames);
+}
+
+{% endif %}
+static void *worker_thread(void *userdata)
+{
+    RackWorker *worker = (RackWorker *)userdata;
+    JackRack &rack = *worker->rack;
+{% if RealtimeHardening|default(0) %}
+    prefault_stack(nullptr);
+{% endif %}
+    for (;;) {
+        while (sem_wait(&worker->wake) != 0) {}
+        if (rack.quit.load(std::memory_order_acquire))
+            break;
+        run_work(rack, worker->index);
+    }
+    return nullptr;
+}
+
+// the sum of an output channel of the instances which have no successor
+static void mix_sinks(JackRack &rack, unsigned channel, float *sum, unsigned count) noexcept
+{
+    std::fill(sum, sum + count, 0.0f);
+    for (unsigned s : rack.sinks) {
+        const float *x = rack.nodes[s]->output[channel];
+        for (unsigned i = 0; i < count; ++i)
+            sum[i] += x[i];
+    }
+}
+
+static int process(jack_nframes_t count, void *userdata)
+{
+    JackRack *rack = (JackRack *)userdata;
+
+    {% for i in range(inputs) %}
+    const float *in{{i}} = (const float *)jack_port_get_buffer(rack->port_in[{{i}}], count);
+    {% endfor %}
+    {% for i in range(outputs) %}
+    float *out{{i}} = (float *)jack_port_get_buffer(rack->port_out[{{i}}], count);
+    {% endfor %}
+
+    for (unsigned index = 0; index < count;) {
+        unsigned segment = count - index;
+        if (segment > RackFrames)
+            segment = RackFrames;
+        {% for i in range(inputs) %}
+        rack->segment_in[{{i}}] = in{{i}} + index;
+        {% endfor %}
+        run_period(*rack, segment);
+        {% for i in range(outputs) %}
+        mix_sinks(*rack, {{i}}, out{{i}} + index, segment);
+        {% endfor %}
+        index += segment;
+    }
+
+    return 0;
+}
+
+static bool start_workers(JackRack &rack, unsigned count)
+{
+    int priority = jack_client_real_time_priority(rack.client);
+    int realtime = jack_is_realtime(rack.client);
+    unsigned ncpus = std::thread::hardware_concurrency();
+
+    for (unsigned i = 1; i < count; ++i) {
+        RackWorker *worker = new RackWorker;
+        rack.workers.emplace_back(worker);
+        worker->rack = &rack;
+        worker->index = i;
+        sem_init(&worker->wake, 0, 0);
+        if (jack_client_create_thread(rack.client, &worker->thread, priority, realtime, &worker_thread, worker) != 0) {
+            sem_destroy(&worker->wake);
+            rack.workers.pop_back();
+            return false;
+        }
+        if (ncpus > 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(i % ncpus, &set);
+            pthread_setaffinity_np(worker->thread, sizeof(set), &set);
+        }
+    }
+
+    return true;
+}
+
+static void stop_workers(JackRack &rack)
+{
+    rack.quit.store(true, std::memory_order_release);
+    for (std::unique_ptr<RackWorker> &worker : rack.workers)
+        sem_post(&worker->wake);
+    for (std::unique_ptr<RackWorker> &worker : rack.workers) {
+        pthread_join(worker->thread, nullptr);
+        sem_destroy(&worker->wake);
+    }
+    rack.workers.clear();
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "Usage: rack [-n instances] [-j threads] [from>to]...\n"
+            "  Each argument `from>to` connects the outputs of an instance\n"
+            "  to the inputs of another, numbered from 0.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    JackRack rack;
+    unsigned ninstances = 1;
+    unsigned nthreads = 0;
+    std::vector<std::pair<unsigned, unsigned>> edges;
+
+    for (int c; (c = getopt(argc, argv, "n:j:h")) != -1;) {
+        switch (c) {
+        case 'n':
+            ninstances = (unsigned)atoi(optarg);
+            break;
+        case 'j':
+            nthreads = (unsigned)atoi(optarg);
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    for (int i = optind; i < argc; ++i) {
+        unsigned from, to;
+        if (sscanf(argv[i], "%u>%u", &from, &to) != 2) {
+            usage();
+            return 1;
+        }
+        edges.emplace_back(from, to);
+        ninstances = std::max(ninstances, std::max(from, to) + 1);
+    }
+    if (ninstances < 1) {
+        usage();
+        return 1;
+    }
+
+    for (unsigned i = 0; i < ninstances; ++i)
+        rack.nodes.emplace_back(new RackNode);
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    for (const std::pair<unsigned, unsigned> &edge : edges) {
+        rack.nodes[edge.first]->successors.push_back(edge.second);
+        rack.nodes[edge.second]->predecessors.push_back(edge.first);
+    }
+    for (unsigned i = 0; i < ninstances; ++i) {
+        RackNode &node = *rack.nodes[i];
+        std::sort(node.predecessors.begin(), node.predecessors.end());
+        if (node.predecessors.empty())
+            rack.sources.push_back(i);
+        if (node.successors.empty())
+            rack.sinks.push_back(i);
+    }
+
+    // check that the graph is acyclic, by sorting it topologically
+    {
+        std::vector<unsigned> pending(ninstances);
+        std::vector<unsigned> ready = rack.sources;
+        for (unsigned i = 0; i < ninstances; ++i)
+            pending[i] = (unsigned)rack.nodes[i]->predecessors.size();
+        unsigned sorted = 0;
+        while (!ready.empty()) {
+            unsigned index = ready.back();
+            ready.pop_back();
+            ++sorted;
+            for (unsigned s : rack.nodes[index]->successors) {
+                if (--pending[s] == 0)
+                    ready.push_back(s);
+            }
+        }
+        if (sorted != ninstances) {
+            fprintf(stderr, "The connections of the rack have a cycle.\n");
+            return 1;
+        }
+    }
+
+    if (nthreads == 0)
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+    nthreads = std::min(nthreads, ninstances);
+    for (unsigned i = 0; i < nthreads; ++i)
+        rack.deques.emplace_back(new RackDeque(ninstances));
+
+    rack.client = jack_client_open({{cstr(name)}}, JackNoStartServer, nullptr);
+    if (!rack.client) {
+        fprintf(stderr, "Cannot open JACK client.\n");
+        return 1;
+    }
+
+    {% if inputs > 0 %}
+    if (!(
+        {% for i in range(inputs) %}
+        (rack.port_in[{{i}}] = jack_port_register(rack.client, "in_{{i}}", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0))
+        {% if not loop.last %}&&{% endif %}
+        {% endfor %})) {
+        fprintf(stderr, "Cannot register JACK inputs.\n");
+        jack_client_close(rack.client);
+        return 1;
+    }
+    {% endif %}
+
+    {% if outputs > 0 %}
+    if (!(
+        {% for i in range(outputs) %}
+        (rack.port_out[{{i}}] = jack_port_register(rack.client, "out_{{i}}", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0))
+        {% if not loop.last %}&&{% endif %}
+        {% endfor %})) {
+        fprintf(stderr, "Cannot register JACK outputs.\n");
+        jack_client_close(rack.client);
+        return 1;
+    }
+    {% endif %}
+
+    jack_set_process_callback(rack.client, &process, &rack);
+
+    for (std::unique_ptr<RackNode> &node : rack.nodes)
+        node->dsp.init(jack_get_sample_rate(rack.client));
+
+{% if RealtimeHardening|default(0) %}
+    jack_set_thread_init_callback(rack.client, &prefault_stack, nullptr);
+    warm_up(rack);
+    if (mlockall(MCL_CURRENT|MCL_FUTURE) != 0)
+        fprintf(stderr, "Cannot lock the memory.\n");
+{% endif %}
+
+    if (!start_workers(rack, nthreads)) {
+        fprintf(stderr, "Cannot create the worker threads.\n");
+        stop_workers(rack);
+        jack_client_close(rack.client);
+        return 1;
+    }
+
+    if (jack_activate(rack.client) != 0) {
+        fprintf(stderr, "Cannot activate JACK client.\n");
+        stop_workers(rack);
+        jack_client_close(rack.client);
+        return 1;
+    }
+
+    for (;;)
+        pause();
+
+    return 0;
+}
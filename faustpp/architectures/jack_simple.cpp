@@ -3,25 +3,174 @@
 //------------------------------------------------------------------------------
 
 #include <jack/jack.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <time.h>
+#include <atomic>
+#include <string>
+{% if RealtimeHardening|default(0) %}
+#include <vector>
+#include <algorithm>
+{% endif %}
+#include <new>
+#include <cstdint>
 #include <cstdio>
 
+//------------------------------------------------------------------------------
+// The statistics of the processing, published in the shared memory segment
+// named `/faustpp.<client name>`, where a monitoring tool can map them.
+// Only the audio thread writes the segment, and the readers never block it.
+
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#   error The statistics require lock-free 64-bit atomics.
+#endif
+
+enum { MonitorMagic = 0x4d505046 }; // "FPPM"
+enum { MonitorVersion = 1 };
+enum { MonitorLoadBins = 101 };
+enum { MonitorTimelineLength = 1024 };
+
+struct JackMonitorPeriod {
+    std::atomic<uint64_t> start_ns; // the start of the callback, monotonic
+    std::atomic<uint64_t> dsp_ns; // the time taken by the processing
+    std::atomic<uint64_t> frames; // the frame time of JACK at the period start
+    std::atomic<uint64_t> count; // the number of frames in the period
+};
+
+struct JackMonitor {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sample_rate;
+    uint32_t reserved;
+    std::atomic<uint64_t> callbacks;
+    std::atomic<uint64_t> xruns; // reported by JACK
+    std::atomic<uint64_t> overloads; // the processing took more than the period
+    std::atomic<uint64_t> last_ns;
+    std::atomic<uint64_t> worst_ns;
+    std::atomic<uint64_t> total_ns;
+    // the number of callbacks by the load of the processing in percent of the
+    // period, with the last bin counting all the loads of 100% and more
+    std::atomic<uint64_t> load_histogram[MonitorLoadBins];
+    // the last periods, in a ring where the index of the next one to be written
+    // is `timeline_count % MonitorTimelineLength`; a reader should read the
+    // count before and after the copy, and drop the entries overwritten between
+    std::atomic<uint64_t> timeline_count;
+    JackMonitorPeriod timeline[MonitorTimelineLength];
+};
+
+static uint64_t monotonic_ns() noexcept
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+// the writer is single, so the counters are incremented without a RMW
+static void monitor_add(std::atomic<uint64_t> &counter, uint64_t value) noexcept
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static JackMonitor *monitor_open(const char *client_name, uint32_t sample_rate)
+{
+    std::string name = std::string("/faustpp.") + client_name;
+    for (size_t i = 1; i < name.size(); ++i) {
+        if (name[i] == '/')
+            name[i] = '_';
+    }
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT|O_RDWR, 0644);
+    if (fd == -1)
+        return nullptr;
+    if (ftruncate(fd, sizeof(JackMonitor)) == -1) {
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    void *addr = mmap(nullptr, sizeof(JackMonitor), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    // the segment is zero-filled, which initializes all the counters
+    JackMonitor *monitor = new (addr) JackMonitor;
+    monitor->magic = MonitorMagic;
+    monitor->version = MonitorVersion;
+    monitor->sample_rate = sample_rate;
+    return monitor;
+}
+
+//------------------------------------------------------------------------------
+
 struct JackAudioContext {
     jack_client_t *client;
     jack_port_t *port_in[{{inputs}}];
     jack_port_t *port_out[{{outputs}}];
+    JackMonitor *monitor;
     {{Identifier}} dsp;
 };
 
 static int process(jack_nframes_t count, void *userdata)
 {
     JackAudioContext *jack = (JackAudioContext *)userdata;
+    JackMonitor *monitor = jack->monitor;
+
+    uint64_t start = monotonic_ns();
     jack->dsp.process(
         {% for i in range(inputs) %}(float *)jack_port_get_buffer(jack->port_in[{{i}}], count),{% endfor %}
         {% for i in range(outputs) %}(float *)jack_port_get_buffer(jack->port_out[{{i}}], count),{% endfor %}
         count);
+    uint64_t elapsed = monotonic_ns() - start;
+
+    if (monitor) {
+        uint64_t period = (uint64_t)count * 1000000000 / monitor->sample_rate;
+        monitor_add(monitor->callbacks, 1);
+        monitor_add(monitor->total_ns, elapsed);
+        monitor->last_ns.store(elapsed, std::memory_order_relaxed);
+        if (elapsed > monitor->worst_ns.load(std::memory_order_relaxed))
+            monitor->worst_ns.store(elapsed, std::memory_order_relaxed);
+        if (elapsed > period)
+            monitor_add(monitor->overloads, 1);
+
+        uint64_t bin = (period > 0) ? (elapsed * 100 / period) : (MonitorLoadBins - 1);
+        if (bin > MonitorLoadBins - 1)
+            bin = MonitorLoadBins - 1;
+        monitor_add(monitor->load_histogram[bin], 1);
+
+        uint64_t index = monitor->timeline_count.load(std::memory_order_relaxed);
+        JackMonitorPeriod &entry = monitor->timeline[index % MonitorTimelineLength];
+        entry.start_ns.store(start, std::memory_order_relaxed);
+        entry.dsp_ns.store(elapsed, std::memory_order_relaxed);
+        entry.frames.store(jack_last_frame_time(jack->client), std::memory_order_relaxed);
+        entry.count.store(count, std::memory_order_relaxed);
+        monitor->timeline_count.store(index + 1, std::memory_order_release);
+    }
+
+    return 0;
+}
+
+static int xrun(void *userdata)
+{
+    JackAudioContext *jack = (JackAudioContext *)userdata;
+    if (jack->monitor)
+        jack->monitor->xruns.fetch_add(1, std::memory_order_relaxed);
     return 0;
 }
+{% if RealtimeHardening|default(0) %}
+
+{% include "realtime_hardening.inc" %}
+
+static void warm_up(JackAudioContext &jack)
+{
+    unsigned count = jack_get_buffer_size(jack.client);
+    std::vector<float> buffer(({{inputs + outputs}}) * count);
+    warm_up_dsp(jack.dsp, buffer.data(), buffer.data() + {{inputs}} * count, count);
+}
+{% endif %}
 
 int main()
 {
@@ -57,10 +206,22 @@ int main()
     }
     {% endif %}
 
+    jack.monitor = monitor_open(jack_get_client_name(jack.client), jack_get_sample_rate(jack.client));
+    if (!jack.monitor)
+        fprintf(stderr, "Cannot create the shared memory of the statistics.\n");
+
     jack_set_process_callback(jack.client, &process, &jack);
+    jack_set_xrun_callback(jack.client, &xrun, &jack);
 
     jack.dsp.init(jack_get_sample_rate(jack.client));
 
+{% if RealtimeHardening|default(0) %}
+    jack_set_thread_init_callback(jack.client, &prefault_stack, nullptr);
+    warm_up(jack);
+    if (mlockall(MCL_CURRENT|MCL_FUTURE) != 0)
+        fprintf(stderr, "Cannot lock the memory.\n");
+
+{% endif %}
     if (jack_activate(jack.client) != 0) {
         fprintf(stderr, "Cannot activate JACK client.\n");
         jack_client_close(jack.client);
@@ -0,0 +1,307 @@
+#include "{{Identifier}}.hpp"
+
+//------------------------------------------------------------------------------
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+
+// A host without any audio device, for the soak and load tests.
+//
+// A realtime thread wakes up at the absolute times of the periods, as the
+// interrupts of a sound card would, and processes the instances. The periods
+// where the processing ends after the next period are counted as deadline
+// misses, after which the schedule skips to the next period to come.
+//
+// The input is either a noise which is the same at each run, or the contents
+// of a file of raw 32-bit float samples with {{inputs}} interleaved channels,
+// played in a loop.
+
+enum { LoadBins = 101 };
+enum { LatencyBins = 32 };
+
+struct NullHostOptions {
+    unsigned sample_rate = 48000;
+    unsigned period = 256;
+    double duration = 10;
+    unsigned instances = 1;
+    int priority = 80;
+    bool lock_memory = false;
+    const char *input_file = nullptr;
+    uint32_t seed = 1;
+    uint64_t max_misses = UINT64_MAX;
+};
+
+struct NullHostStats {
+    uint64_t periods = 0;
+    uint64_t misses = 0;
+    uint64_t dropped = 0;
+    uint64_t total_ns = 0;
+    uint64_t worst_ns = 0;
+    uint64_t total_latency_ns = 0;
+    uint64_t worst_latency_ns = 0;
+    // the processing time, in percent of the period
+    uint64_t load[LoadBins] = {};
+    // the lateness of the wake-ups, by powers of 2 in nanoseconds
+    uint64_t latency[LatencyBins] = {};
+};
+
+struct NullHost {
+    NullHostOptions options;
+    NullHostStats stats;
+    std::vector<std::unique_ptr<{{Identifier}}>> instances;
+    std::vector<float> source; // interleaved
+    size_t source_frame = 0;
+    std::vector<float> input; // {{inputs}} x period
+    std::vector<float> output; // {{outputs}} x period
+};
+
+static uint64_t timespec_ns(const timespec &ts)
+{
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static timespec ns_timespec(uint64_t ns)
+{
+    timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000);
+    ts.tv_nsec = (long)(ns % 1000000000);
+    return ts;
+}
+
+static uint64_t monotonic_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return timespec_ns(ts);
+}
+
+static void fill_input(NullHost &host)
+{
+    const unsigned period = host.options.period;
+    const size_t frames = host.source.size() / {{[inputs, 1]|max}};
+    for (unsigned i = 0; i < period; ++i) {
+        {% for c in range(inputs) %}
+        host.input[{{c}} * period + i] = host.source[host.source_frame * {{inputs}} + {{c}}];
+        {% endfor %}
+        if (++host.source_frame == frames)
+            host.source_frame = 0;
+    }
+}
+
+static void run_period(NullHost &host)
+{
+    const unsigned period = host.options.period;
+    float *in = host.input.data();
+    float *out = host.output.data();
+    (void)in;
+    (void)out;
+    for (std::unique_ptr<{{Identifier}}> &dsp : host.instances)
+        dsp->process(
+            {% for i in range(inputs) %}in + {{i}} * period,{% endfor %}
+            {% for i in range(outputs) %}out + {{i}} * period,{% endfor %}
+            period);
+}
+
+static void *host_thread(void *userdata)
+{
+    NullHost &host = *(NullHost *)userdata;
+    NullHostStats &stats = host.stats;
+    const uint64_t period_ns = (uint64_t)host.options.period * 1000000000 / host.options.sample_rate;
+    const uint64_t count = (uint64_t)(host.options.duration * host.options.sample_rate / host.options.period);
+
+    uint64_t wake = monotonic_ns() + period_ns;
+    fill_input(host);
+
+    while (stats.periods < count) {
+        timespec ts = ns_timespec(wake);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+
+        uint64_t start = monotonic_ns();
+        run_period(host);
+        uint64_t end = monotonic_ns();
+
+        uint64_t elapsed = end - start;
+        uint64_t lateness = start - wake;
+        stats.total_ns += elapsed;
+        if (elapsed > stats.worst_ns)
+            stats.worst_ns = elapsed;
+        stats.total_latency_ns += lateness;
+        if (lateness > stats.worst_latency_ns)
+            stats.worst_latency_ns = lateness;
+
+        uint64_t load = elapsed * 100 / period_ns;
+        ++stats.load[(load < LoadBins) ? load : (LoadBins - 1)];
+        unsigned bin = 0;
+        while (bin + 1 < LatencyBins && (lateness >> (bin + 1)) != 0)
+            ++bin;
+        ++stats.latency[bin];
+
+        ++stats.periods;
+        wake += period_ns;
+        if (end > wake) {
+            ++stats.misses;
+            uint64_t skip = (end - wake) / period_ns + 1;
+            stats.dropped += skip;
+            wake += skip * period_ns;
+        }
+
+        fill_input(host);
+    }
+
+    return nullptr;
+}
+
+static bool start_thread(NullHost &host, pthread_t &thread)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    param.sched_priority = host.options.priority;
+    pthread_attr_setschedparam(&attr, &param);
+    int err = pthread_create(&thread, &attr, &host_thread, &host);
+    pthread_attr_destroy(&attr);
+
+    if (err == EPERM) {
+        fprintf(stderr, "Cannot use SCHED_FIFO, the timings are not realtime.\n");
+        err = pthread_create(&thread, nullptr, &host_thread, &host);
+    }
+
+    return err == 0;
+}
+
+static bool load_source(NullHost &host)
+{
+    if (!host.options.input_file) {
+        // one second of a white noise, at -12 dB
+        uint32_t x = host.options.seed ? host.options.seed : 1;
+        host.source.resize((size_t)host.options.sample_rate * {{inputs}});
+        for (float &sample : host.source) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            sample = 0.25f * ((float)x / 2147483648.0f - 1.0f);
+        }
+    }
+    else {
+        FILE *file = fopen(host.options.input_file, "rb");
+        if (!file)
+            return false;
+        float buffer[1024];
+        for (size_t n; (n = fread(buffer, sizeof(float), 1024, file)) > 0;)
+            host.source.insert(host.source.end(), buffer, buffer + n);
+        fclose(file);
+        host.source.resize(host.source.size() - host.source.size() % ({{inputs}} ? {{inputs}} : 1));
+    }
+
+    if (host.source.empty())
+        host.source.assign({{inputs}} ? {{inputs}} : 1, 0.0f);
+    return true;
+}
+
+static void report(const NullHost &host)
+{
+    const NullHostStats &stats = host.stats;
+    const double period_us = 1e6 * host.options.period / host.options.sample_rate;
+    const uint64_t periods = stats.periods ? stats.periods : 1;
+
+    printf("Periods: %llu of %.1f us, instances: %u\n",
+           (unsigned long long)stats.periods, period_us, host.options.instances);
+    printf("Deadline misses: %llu, dropped periods: %llu\n",
+           (unsigned long long)stats.misses, (unsigned long long)stats.dropped);
+    printf("Processing: mean %.1f us, worst %.1f us, mean load %.1f%%, worst load %.1f%%\n",
+           1e-3 * stats.total_ns / periods, 1e-3 * stats.worst_ns,
+           1e-1 * stats.total_ns / periods / period_us, 1e-1 * stats.worst_ns / period_us);
+    printf("Wake-up lateness: mean %.1f us, worst %.1f us\n",
+           1e-3 * stats.total_latency_ns / periods, 1e-3 * stats.worst_latency_ns);
+
+    printf("Load histogram:\n");
+    for (unsigned i = 0; i < LoadBins; ++i) {
+        if (stats.load[i])
+            printf("  %s%3u%%: %llu\n", (i == LoadBins - 1) ? ">=" : "  ", i, (unsigned long long)stats.load[i]);
+    }
+    printf("Wake-up lateness histogram:\n");
+    for (unsigned i = 0; i < LatencyBins; ++i) {
+        if (stats.latency[i])
+            printf("  < %10.3f us: %llu\n", 1e-3 * (double)(2ull << i), (unsigned long long)stats.latency[i]);
+    }
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "Usage: null_host [options]\n"
+            "  -r <rate>      sample rate (48000)\n"
+            "  -p <frames>    period size (256)\n"
+            "  -d <seconds>   duration (10)\n"
+            "  -n <count>     number of instances (1)\n"
+            "  -P <priority>  SCHED_FIFO priority (80)\n"
+            "  -i <file>      input of raw interleaved 32-bit floats\n"
+            "  -s <seed>      seed of the noise input (1)\n"
+            "  -x <count>     fail if there are more deadline misses\n"
+            "  -l             lock the memory\n");
+}
+
+int main(int argc, char *argv[])
+{
+    NullHost host;
+    NullHostOptions &options = host.options;
+
+    for (int c; (c = getopt(argc, argv, "r:p:d:n:P:i:s:x:lh")) != -1;) {
+        switch (c) {
+        case 'r': options.sample_rate = (unsigned)atoi(optarg); break;
+        case 'p': options.period = (unsigned)atoi(optarg); break;
+        case 'd': options.duration = atof(optarg); break;
+        case 'n': options.instances = (unsigned)atoi(optarg); break;
+        case 'P': options.priority = atoi(optarg); break;
+        case 'i': options.input_file = optarg; break;
+        case 's': options.seed = (uint32_t)strtoul(optarg, nullptr, 0); break;
+        case 'x': options.max_misses = strtoull(optarg, nullptr, 0); break;
+        case 'l': options.lock_memory = true; break;
+        default: usage(); return 1;
+        }
+    }
+    if (options.sample_rate < 1 || options.period < 1 || options.instances < 1) {
+        usage();
+        return 1;
+    }
+
+    if (!load_source(host)) {
+        fprintf(stderr, "Cannot read the input file.\n");
+        return 1;
+    }
+
+    host.input.resize((size_t)({{inputs}}) * options.period);
+    host.output.resize((size_t)({{outputs}}) * options.period);
+    for (unsigned i = 0; i < options.instances; ++i) {
+        {{Identifier}} *dsp = new {{Identifier}};
+        host.instances.emplace_back(dsp);
+        dsp->init(options.sample_rate);
+    }
+
+    if (options.lock_memory && mlockall(MCL_CURRENT|MCL_FUTURE) != 0)
+        fprintf(stderr, "Cannot lock the memory.\n");
+
+    pthread_t thread;
+    if (!start_thread(host, thread)) {
+        fprintf(stderr, "Cannot create the processing thread.\n");
+        return 1;
+    }
+    pthread_join(thread, nullptr);
+
+    report(host);
+
+    return (host.stats.misses > options.max_misses) ? 2 : 0;
+}
@@ -0,0 +1,893 @@
+#include "{{Identifier}}.hpp"
+
+//------------------------------------------------------------------------------
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+
+// An offline renderer, which processes a file through the DSP into another.
+//
+// The input is mapped in memory, and read sequentially by large blocks. The
+// pages already read are released, so the memory used remains the same for
+// any size of file. The output is written by a single write per block, or with
+// the option `-D`, directly to the disk without going through the page cache.
+//
+// The files are either WAV, including RF64 for the sizes above 4 GiB, or raw
+// interleaved samples of the format given by the option `-f`.
+//
+// With the option `-j`, a long file is rendered by chunks on multiple threads,
+// and the option `-V` compares the result with the sequential rendering.
+
+enum SampleFormat {
+    FormatS16,
+    FormatS24,
+    FormatS32,
+    FormatF32,
+    FormatF64,
+};
+
+struct FormatInfo {
+    const char *name;
+    unsigned bytes;
+    bool is_float;
+};
+
+static const FormatInfo format_info[] = {
+    { "s16", 2, false },
+    { "s24", 3, false },
+    { "s32", 4, false },
+    { "f32", 4, true },
+    { "f64", 8, true },
+};
+
+static bool parse_format(const char *name, SampleFormat &format)
+{
+    for (unsigned i = 0; i < sizeof(format_info) / sizeof(format_info[0]); ++i) {
+        if (!std::strcmp(name, format_info[i].name)) {
+            format = (SampleFormat)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool has_wav_extension(const char *path)
+{
+    size_t length = std::strlen(path);
+    return length >= 4 && !strcasecmp(path + length - 4, ".wav");
+}
+
+static uint64_t monotonic_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+// The conversion of the samples, which are little-endian
+
+static void read_samples(const uint8_t *src, SampleFormat format, unsigned channels,
+                         float *const dst[], size_t offset, size_t frames)
+{
+    const unsigned stride = format_info[format].bytes * channels;
+    for (unsigned c = 0; c < channels; ++c) {
+        const uint8_t *p = src + c * format_info[format].bytes;
+        float *out = dst[c] + offset;
+        switch (format) {
+        case FormatS16:
+            for (size_t i = 0; i < frames; ++i, p += stride)
+                out[i] = (int16_t)(p[0] | (p[1] << 8)) * (1.0f / 32768);
+            break;
+        case FormatS24:
+            for (size_t i = 0; i < frames; ++i, p += stride)
+                out[i] = (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24)) * (1.0f / 2147483648.0f);
+            break;
+        case FormatS32:
+            for (size_t i = 0; i < frames; ++i, p += stride) {
+                int32_t s;
+                std::memcpy(&s, p, 4);
+                out[i] = s * (1.0f / 2147483648.0f);
+            }
+            break;
+        case FormatF32:
+            for (size_t i = 0; i < frames; ++i, p += stride)
+                std::memcpy(&out[i], p, 4);
+            break;
+        case FormatF64:
+            for (size_t i = 0; i < frames; ++i, p += stride) {
+                double s;
+                std::memcpy(&s, p, 8);
+                out[i] = (float)s;
+            }
+            break;
+        }
+    }
+}
+
+static int32_t quantize(float x, float scale, int32_t min, int32_t max)
+{
+    float y = std::nearbyint(x * scale);
+    return (y <= min) ? min : (y >= max) ? max : (int32_t)y;
+}
+
+static void write_samples(uint8_t *dst, SampleFormat format, unsigned channels,
+                          const float *const src[], size_t frames)
+{
+    const unsigned stride = format_info[format].bytes * channels;
+    for (unsigned c = 0; c < channels; ++c) {
+        uint8_t *p = dst + c * format_info[format].bytes;
+        const float *in = src[c];
+        switch (format) {
+        case FormatS16:
+            for (size_t i = 0; i < frames; ++i, p += stride) {
+                int32_t s = quantize(in[i], 32768.0f, -32768, 32767);
+                p[0] = (uint8_t)s;
+                p[1] = (uint8_t)(s >> 8);
+            }
+            break;
+        case FormatS24:
+            for (size_t i = 0; i < frames; ++i, p += stride) {
+                int32_t s = quantize(in[i], 8388608.0f, -8388608, 8388607);
+                p[0] = (uint8_t)s;
+                p[1] = (uint8_t)(s >> 8);
+                p[2] = (uint8_t)(s >> 16);
+            }
+            break;
+        case FormatS32:
+            for (size_t i = 0; i < frames; ++i, p += stride) {
+                // the float does not represent INT32_MAX, so clamp below
+                int32_t s = quantize(in[i], 2147483648.0f, INT32_MIN, 2147483520);
+                std::memcpy(p, &s, 4);
+            }
+            break;
+        case FormatF32:
+            for (size_t i = 0; i < frames; ++i, p += stride)
+                std::memcpy(p, &in[i], 4);
+            break;
+        case FormatF64:
+            for (size_t i = 0; i < frames; ++i, p += stride) {
+                double s = in[i];
+                std::memcpy(p, &s, 8);
+            }
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// The input file
+
+struct InputFile {
+    ~InputFile();
+    bool open(const char *path, SampleFormat raw_format, unsigned raw_rate, unsigned raw_channels);
+    void release(size_t frame);
+
+    int fd = -1;
+    const uint8_t *map = nullptr;
+    size_t map_size = 0;
+    const uint8_t *data = nullptr;
+    size_t frames = 0;
+    unsigned channels = 0;
+    unsigned sample_rate = 0;
+    SampleFormat format = FormatF32;
+    size_t released = 0;
+};
+
+InputFile::~InputFile()
+{
+    if (map)
+        munmap(const_cast<uint8_t *>(map), map_size);
+    if (fd != -1)
+        close(fd);
+}
+
+static uint32_t get_u16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t get_u32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint64_t get_u64(const uint8_t *p) { return get_u32(p) | ((uint64_t)get_u32(p + 4) << 32); }
+
+bool InputFile::open(const char *path, SampleFormat raw_format, unsigned raw_rate, unsigned raw_channels)
+{
+    fd = ::open(path, O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Cannot open the input file.\n");
+        return false;
+    }
+
+    map_size = (size_t)st.st_size;
+    if (map_size > 0) {
+        void *memory = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (memory == MAP_FAILED) {
+            fprintf(stderr, "Cannot map the input file.\n");
+            return false;
+        }
+        map = (const uint8_t *)memory;
+        madvise(memory, map_size, MADV_SEQUENTIAL);
+    }
+
+    size_t data_size = 0;
+    if (!has_wav_extension(path)) {
+        channels = raw_channels;
+        sample_rate = raw_rate;
+        format = raw_format;
+        data = map;
+        data_size = map_size;
+    }
+    else {
+        bool rf64 = map_size >= 12 && !std::memcmp(map, "RF64", 4);
+        if (map_size < 12 || (std::memcmp(map, "RIFF", 4) && !rf64) || std::memcmp(map + 8, "WAVE", 4)) {
+            fprintf(stderr, "The input file is not a WAV file.\n");
+            return false;
+        }
+        uint64_t ds64_data_size = 0;
+        bool has_format = false;
+        for (size_t pos = 12; pos + 8 <= map_size;) {
+            const uint8_t *chunk = map + pos;
+            uint64_t size = get_u32(chunk + 4);
+            if (!std::memcmp(chunk, "ds64", 4) && size >= 16 && pos + 8 + 16 <= map_size)
+                ds64_data_size = get_u64(chunk + 16);
+            else if (!std::memcmp(chunk, "fmt ", 4) && size >= 16 && pos + 8 + 16 <= map_size) {
+                unsigned tag = get_u16(chunk + 8);
+                if (tag == 0xfffe && size >= 40)
+                    tag = get_u16(chunk + 8 + 24);
+                channels = get_u16(chunk + 10);
+                sample_rate = get_u32(chunk + 12);
+                unsigned bits = get_u16(chunk + 22);
+                has_format = true;
+                if (tag == 1 && bits == 16)
+                    format = FormatS16;
+                else if (tag == 1 && bits == 24)
+                    format = FormatS24;
+                else if (tag == 1 && bits == 32)
+                    format = FormatS32;
+                else if (tag == 3 && bits == 32)
+                    format = FormatF32;
+                else if (tag == 3 && bits == 64)
+                    format = FormatF64;
+                else
+                    has_format = false;
+            }
+            else if (!std::memcmp(chunk, "data", 4)) {
+                if (rf64 && size == 0xffffffff)
+                    size = ds64_data_size;
+                data = chunk + 8;
+                data_size = (size_t)std::min<uint64_t>(size, map_size - pos - 8);
+                break;
+            }
+            pos += 8 + size + (size & 1);
+        }
+        if (!has_format || !data) {
+            fprintf(stderr, "The format of the input file is not supported.\n");
+            return false;
+        }
+    }
+
+    frames = channels ? data_size / (format_info[format].bytes * channels) : 0;
+    return true;
+}
+
+// release the pages before the given frame, which were read
+void InputFile::release(size_t frame)
+{
+    if (!map)
+        return;
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t end = (size_t)(data - map) + frame * format_info[format].bytes * channels;
+    end -= end % page;
+    if (end > released) {
+        madvise(const_cast<uint8_t *>(map) + released, end - released, MADV_DONTNEED);
+        released = end;
+    }
+}
+
+//------------------------------------------------------------------------------
+// The output file
+//
+// The WAV header reserves a chunk `JUNK`, which becomes the chunk `ds64` of
+// RF64 if the data exceeds the limits of WAV. With the direct writes, this
+// chunk also pads the header to the alignment of the disk.
+
+enum { DirectAlignment = 4096 };
+enum { WavHeaderSize = 80 };
+
+struct OutputFile {
+    ~OutputFile();
+    bool open(const char *path, SampleFormat format, unsigned channels, unsigned sample_rate, bool direct, size_t block_bytes);
+    bool write(size_t bytes);
+    // write data at an offset from the start of the data, without the buffer
+    bool write_at(const uint8_t *data, size_t bytes, uint64_t offset);
+    bool finish();
+
+    int fd = -1;
+    bool wav = false;
+    bool direct = false;
+    SampleFormat format = FormatF32;
+    unsigned channels = 0;
+    unsigned sample_rate = 0;
+    size_t header_size = 0;
+    uint64_t data_size = 0;
+    // the pending data, the next block being converted at `buffer + fill`
+    uint8_t *buffer = nullptr;
+    size_t fill = 0;
+};
+
+OutputFile::~OutputFile()
+{
+    std::free(buffer);
+    if (fd != -1)
+        close(fd);
+}
+
+static void put_u16(uint8_t *p, uint32_t x) { p[0] = (uint8_t)x; p[1] = (uint8_t)(x >> 8); }
+static void put_u32(uint8_t *p, uint32_t x) { put_u16(p, x & 0xffff); put_u16(p + 2, x >> 16); }
+static void put_u64(uint8_t *p, uint64_t x) { put_u32(p, (uint32_t)x); put_u32(p + 4, (uint32_t)(x >> 32)); }
+
+static bool write_all(int fd, const uint8_t *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t count = ::write(fd, data, size);
+        if (count == -1 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        data += count;
+        size -= (size_t)count;
+    }
+    return true;
+}
+
+bool OutputFile::open(const char *path, SampleFormat format_, unsigned channels_, unsigned sample_rate_, bool direct_, size_t block_bytes)
+{
+    format = format_;
+    channels = channels_;
+    sample_rate = sample_rate_;
+    wav = has_wav_extension(path);
+    direct = direct_;
+    header_size = wav ? (direct ? (size_t)DirectAlignment : (size_t)WavHeaderSize) : 0;
+
+    fd = ::open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (fd == -1) {
+        fprintf(stderr, "Cannot open the output file.\n");
+        return false;
+    }
+
+    // the buffer holds a block, and what remains of the previous one
+    void *memory = nullptr;
+    if (posix_memalign(&memory, DirectAlignment, block_bytes + DirectAlignment) != 0)
+        return false;
+    buffer = (uint8_t *)memory;
+
+    // reserve the header, and write it for real at the end
+    std::vector<uint8_t> header(header_size, 0);
+    if (!write_all(fd, header.data(), header.size()))
+        return false;
+
+    if (direct && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_DIRECT) != 0) {
+        fprintf(stderr, "Cannot write directly, using the page cache.\n");
+        direct = false;
+    }
+    return true;
+}
+
+bool OutputFile::write(size_t bytes)
+{
+    fill += bytes;
+    data_size += bytes;
+    size_t count = direct ? (fill - fill % DirectAlignment) : fill;
+    if (!write_all(fd, buffer, count))
+        return false;
+    std::memmove(buffer, buffer + count, fill - count);
+    fill -= count;
+    return true;
+}
+
+bool OutputFile::write_at(const uint8_t *data, size_t bytes, uint64_t offset)
+{
+    offset += header_size;
+    while (bytes > 0) {
+        ssize_t count = pwrite(fd, data, bytes, (off_t)offset);
+        if (count == -1 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        data += count;
+        bytes -= (size_t)count;
+        offset += (uint64_t)count;
+    }
+    return true;
+}
+
+bool OutputFile::finish()
+{
+    if (direct) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+        direct = false;
+    }
+    if (!write_all(fd, buffer, fill))
+        return false;
+    fill = 0;
+
+    if (!wav)
+        return true;
+
+    // the parallel rendering writes by offsets, so the position of the file
+    // is not at the end of the data
+    uint8_t pad = data_size & 1;
+    if (pad && pwrite(fd, &pad, 1, (off_t)(header_size + data_size)) != 1)
+        return false;
+
+    const FormatInfo &info = format_info[format];
+    const uint64_t riff_size = header_size - 8 + data_size + pad;
+    const bool rf64 = riff_size > 0xffffffff;
+
+    std::vector<uint8_t> header(header_size, 0);
+    uint8_t *p = header.data();
+    std::memcpy(p, rf64 ? "RF64" : "RIFF", 4);
+    put_u32(p + 4, rf64 ? 0xffffffff : (uint32_t)riff_size);
+    std::memcpy(p + 8, "WAVE", 4);
+    // the chunk `JUNK` or `ds64` fills the header up to the chunk `fmt `
+    const size_t junk_size = header_size - 12 - 8 - 8 - 16 - 8;
+    std::memcpy(p + 12, rf64 ? "ds64" : "JUNK", 4);
+    put_u32(p + 16, (uint32_t)junk_size);
+    if (rf64) {
+        put_u64(p + 20, riff_size);
+        put_u64(p + 28, data_size);
+        put_u64(p + 36, data_size / (info.bytes * channels));
+        put_u32(p + 44, 0);
+    }
+    p += 20 + junk_size;
+    std::memcpy(p, "fmt ", 4);
+    put_u32(p + 4, 16);
+    put_u16(p + 8, info.is_float ? 3 : 1);
+    put_u16(p + 10, channels);
+    put_u32(p + 12, sample_rate);
+    put_u32(p + 16, sample_rate * info.bytes * channels);
+    put_u16(p + 20, info.bytes * channels);
+    put_u16(p + 22, info.bytes * 8);
+    p += 24;
+    std::memcpy(p, "data", 4);
+    put_u32(p + 4, rf64 ? 0xffffffff : (uint32_t)data_size);
+
+    return pwrite(fd, header.data(), header.size(), 0) == (ssize_t)header.size();
+}
+
+
+//------------------------------------------------------------------------------
+// The rendering
+//
+// The frames of the DSP are counted from the start of the input. With the
+// latency compensated, the frame `i` of the output is the frame `i + latency`
+// of the DSP.
+
+struct RenderBuffers {
+    explicit RenderBuffers(size_t block);
+
+    size_t block = 0;
+    std::vector<float> input_buffer;
+    std::vector<float> output_buffer;
+    float *inputs[{{[inputs, 1]|max}}];
+    float *outputs[{{[outputs, 1]|max}}];
+};
+
+RenderBuffers::RenderBuffers(size_t block_)
+    : block(block_),
+      input_buffer((size_t)({{inputs}}) * block_),
+      output_buffer((size_t)({{outputs}}) * block_)
+{
+    for (unsigned c = 0; c < {{inputs}}; ++c)
+        inputs[c] = input_buffer.data() + c * block;
+    for (unsigned c = 0; c < {{outputs}}; ++c)
+        outputs[c] = output_buffer.data() + c * block;
+}
+
+// process the frames of the DSP from `start` to `end`, and pass the output
+// from the frame `first` to `sink(outputs, frames, index)`
+template <class Sink>
+static bool render_range({{Identifier}} &dsp, InputFile &input, size_t input_frames, RenderBuffers &buffers,
+                         size_t start, size_t first, size_t end, bool release, uint64_t &dsp_ns, Sink &&sink)
+{
+    float *const *inputs = buffers.inputs;
+    float *const *outputs = buffers.outputs;
+    (void)inputs;
+
+    for (size_t index = start; index < end;) {
+        size_t frames = std::min(buffers.block, end - index);
+
+        // the input, followed by silence
+        size_t available = (index < input_frames) ? std::min(frames, input_frames - index) : 0;
+        if (available > 0) {
+            const uint8_t *src = input.data + index * format_info[input.format].bytes * input.channels;
+            read_samples(src, input.format, input.channels, inputs, 0, available);
+            if (release)
+                input.release(index + available);
+        }
+        for (unsigned c = 0; c < {{inputs}}; ++c)
+            std::memset(inputs[c] + available, 0, (frames - available) * sizeof(float));
+
+        uint64_t dsp_start = monotonic_ns();
+        dsp.process(
+            {% for i in range(inputs) %}inputs[{{i}}],{% endfor %}
+            {% for i in range(outputs) %}outputs[{{i}}],{% endfor %}
+            (unsigned)frames);
+        dsp_ns += monotonic_ns() - dsp_start;
+
+        // the output, from the first frame
+        size_t skipped = (first > index) ? std::min(first - index, frames) : 0;
+        if (skipped < frames) {
+            float *written[{{[outputs, 1]|max}}];
+            for (unsigned c = 0; c < {{outputs}}; ++c)
+                written[c] = outputs[c] + skipped;
+            if (!sink(written, frames - skipped, index + skipped))
+                return false;
+        }
+
+        index += frames;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// The parallel rendering
+//
+// The output is cut in chunks, which independent instances render on multiple
+// threads. Each chunk is preceded by a pre-roll, whose output is discarded, so
+// that the state of the DSP has converged at the seam with the previous chunk.
+// The pre-roll is given by the option `-p`, or declared by the metadata
+// `preroll` of the DSP, in seconds, or else measured as the time which a new
+// instance takes to join the output of an instance already running, both
+// being given the same noise. This accounts for the state which moves by
+// itself, such as the smoothing of the controls, and for the nonlinear DSP
+// at the level of this noise.
+
+static const double DeclaredPreroll = {{meta.preroll|default(-1)}};
+
+// the length after which a late instance does not differ from an early one by
+// more than the threshold, or the limit if it does not settle
+static size_t measure_preroll(unsigned sample_rate, float threshold, size_t limit, bool &settled)
+{
+    std::unique_ptr<{{Identifier}}> early(new {{Identifier}});
+    std::unique_ptr<{{Identifier}}> late(new {{Identifier}});
+    early->init(sample_rate);
+    late->init(sample_rate);
+
+    const size_t block = 4096;
+    RenderBuffers a(block);
+    RenderBuffers b(block);
+
+    // the response must remain settled for a second, and the late instance
+    // starts after a second, when the early one is past its own start
+    const size_t quiet = std::max<size_t>(sample_rate, block);
+    const size_t stagger = (quiet + block - 1) / block * block;
+    {% if inputs > 0 %}
+    uint32_t seed = 1;
+    {% endif %}
+    size_t last = 0;
+    for (size_t index = 0; index < stagger + limit; index += block) {
+        {% if inputs > 0 %}
+        for (size_t i = 0; i < block; ++i) {
+            {% for i in range(inputs) %}
+            seed = seed * 1664525u + 1013904223u;
+            a.inputs[{{i}}][i] = (float)(int32_t)seed * (0.5f / 2147483648.0f);
+            {% endfor %}
+        }
+        {% endif %}
+        early->process(
+            {% for i in range(inputs) %}a.inputs[{{i}}],{% endfor %}
+            {% for i in range(outputs) %}a.outputs[{{i}}],{% endfor %}
+            (unsigned)block);
+        if (index < stagger)
+            continue;
+
+        {% for i in range(inputs) %}
+        std::memcpy(b.inputs[{{i}}], a.inputs[{{i}}], block * sizeof(float));
+        {% endfor %}
+        late->process(
+            {% for i in range(inputs) %}b.inputs[{{i}}],{% endfor %}
+            {% for i in range(outputs) %}b.outputs[{{i}}],{% endfor %}
+            (unsigned)block);
+
+        const size_t elapsed = index - stagger;
+        for (size_t i = 0; i < block; ++i) {
+            {% for i in range(outputs) %}
+            if (std::fabs(a.outputs[{{i}}][i] - b.outputs[{{i}}][i]) > threshold)
+                last = elapsed + i + 1;
+            {% endfor %}
+        }
+        if (elapsed + block >= last + quiet) {
+            settled = true;
+            return last;
+        }
+    }
+
+    settled = false;
+    return limit;
+}
+
+static bool render_parallel(InputFile &input, size_t input_frames, unsigned sample_rate, size_t latency,
+                            size_t total_frames, size_t block, size_t chunk, size_t preroll, unsigned threads,
+                            OutputFile &output, uint64_t &dsp_ns)
+{
+    const size_t output_frames = total_frames - latency;
+    const size_t chunks = (output_frames + chunk - 1) / chunk;
+    const size_t frame_bytes = format_info[output.format].bytes * output.channels;
+
+    std::atomic<size_t> next_chunk(0);
+    std::atomic<bool> failed(false);
+    std::atomic<uint64_t> total_dsp_ns(0);
+
+    auto work = [&]() {
+        std::unique_ptr<{{Identifier}}> dsp(new {{Identifier}});
+        dsp->init(sample_rate);
+        RenderBuffers buffers(block);
+        std::vector<uint8_t> converted(block * frame_bytes);
+        uint64_t thread_dsp_ns = 0;
+
+        auto sink = [&](float *const outputs[], size_t frames, size_t index) -> bool {
+            write_samples(converted.data(), output.format, {{outputs}}, outputs, frames);
+            return output.write_at(converted.data(), frames * frame_bytes, (uint64_t)(index - latency) * frame_bytes);
+        };
+
+        for (size_t k = next_chunk++; k < chunks && !failed; k = next_chunk++) {
+            // the first chunk starts with the DSP, exactly like the sequential
+            // rendering, and the others after a pre-roll
+            size_t first = k * chunk + latency;
+            size_t end = std::min(first + chunk, total_frames);
+            size_t start = (k > 0 && first > preroll) ? (first - preroll) : 0;
+            dsp->clear();
+            if (!render_range(*dsp, input, input_frames, buffers, start, first, end, false, thread_dsp_ns, sink))
+                failed = true;
+        }
+
+        total_dsp_ns += thread_dsp_ns;
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i)
+        pool.emplace_back(work);
+    for (std::thread &thread : pool)
+        thread.join();
+
+    output.data_size = (uint64_t)output_frames * frame_bytes;
+    dsp_ns = total_dsp_ns;
+    return !failed;
+}
+
+// compare the output file with a sequential rendering, both in the format of
+// the output, and give the largest difference
+static bool verify_output(const char *path, SampleFormat format, InputFile &input, size_t input_frames,
+                          unsigned sample_rate, size_t latency, size_t total_frames, size_t block,
+                          double &max_error, size_t &max_index)
+{
+    InputFile rendered;
+    if (!rendered.open(path, format, sample_rate, {{outputs}}) || rendered.channels != {{outputs}} ||
+        rendered.frames != total_frames - latency)
+        return false;
+
+    std::unique_ptr<{{Identifier}}> dsp(new {{Identifier}});
+    dsp->init(sample_rate);
+    RenderBuffers buffers(block);
+    RenderBuffers expected(block);
+    RenderBuffers actual(block);
+    const size_t frame_bytes = format_info[format].bytes * {{outputs}};
+    std::vector<uint8_t> converted(block * frame_bytes);
+    uint64_t dsp_ns = 0;
+
+    // the input is read again from the start
+    input.released = 0;
+
+    max_error = 0;
+    max_index = 0;
+    auto sink = [&](float *const outputs[], size_t frames, size_t index) -> bool {
+        size_t frame = index - latency;
+        write_samples(converted.data(), format, {{outputs}}, outputs, frames);
+        read_samples(converted.data(), format, {{outputs}}, expected.outputs, 0, frames);
+        read_samples(rendered.data + frame * frame_bytes, format, {{outputs}}, actual.outputs, 0, frames);
+        rendered.release(frame + frames);
+        for (unsigned c = 0; c < {{outputs}}; ++c) {
+            for (size_t i = 0; i < frames; ++i) {
+                double error = std::fabs((double)expected.outputs[c][i] - actual.outputs[c][i]);
+                if (!(error <= max_error)) {
+                    max_error = error;
+                    max_index = frame + i;
+                }
+            }
+        }
+        return true;
+    };
+
+    return render_range(*dsp, input, input_frames, buffers, 0, latency, total_frames, true, dsp_ns, sink);
+}
+
+//------------------------------------------------------------------------------
+
+static void usage()
+{
+    fprintf(stderr,
+            "Usage: offline_render [options] [-i input] -o output\n"
+            "  -i <file>      input, WAV or raw, with {{inputs}} channels\n"
+            "  -o <file>      output, WAV or raw, with {{outputs}} channels\n"
+            "  -f <format>    format of a raw input: s16, s24, s32, f32, f64 (f32)\n"
+            "  -F <format>    format of the output (f32)\n"
+            "  -r <rate>      sample rate of a raw input, or without input (48000)\n"
+            "  -d <seconds>   duration without input\n"
+            "  -t <seconds>   tail of silence after the input (0)\n"
+            "  -b <frames>    block size (65536)\n"
+            "  -L             compensate the latency of the DSP\n"
+            "  -D             write directly to the disk\n"
+            "  -j <threads>   render in parallel chunks, 0 for all the processors (1)\n"
+            "  -c <seconds>   duration of the parallel chunks (30)\n"
+            "  -p <seconds>   pre-roll of the parallel chunks (declared, or measured)\n"
+            "  -e <error>     tolerance of the pre-roll and the verification (1e-4)\n"
+            "  -V             verify the output against a sequential rendering\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *input_path = nullptr;
+    const char *output_path = nullptr;
+    SampleFormat raw_format = FormatF32;
+    SampleFormat output_format = FormatF32;
+    unsigned sample_rate = 48000;
+    double duration = 0;
+    double tail = 0;
+    size_t block = 65536;
+    bool compensate = false;
+    bool direct = false;
+    unsigned threads = 1;
+    double chunk_duration = 30;
+    double preroll_duration = DeclaredPreroll;
+    double tolerance = 1e-4;
+    bool verify = false;
+
+    for (int c; (c = getopt(argc, argv, "i:o:f:F:r:d:t:b:LDj:c:p:e:Vh")) != -1;) {
+        switch (c) {
+        case 'i': input_path = optarg; break;
+        case 'o': output_path = optarg; break;
+        case 'f':
+            if (!parse_format(optarg, raw_format)) { usage(); return 1; }
+            break;
+        case 'F':
+            if (!parse_format(optarg, output_format)) { usage(); return 1; }
+            break;
+        case 'r': sample_rate = (unsigned)atoi(optarg); break;
+        case 'd': duration = atof(optarg); break;
+        case 't': tail = atof(optarg); break;
+        case 'b': block = (size_t)atol(optarg); break;
+        case 'L': compensate = true; break;
+        case 'D': direct = true; break;
+        case 'j': threads = (unsigned)atoi(optarg); break;
+        case 'c': chunk_duration = atof(optarg); break;
+        case 'p': preroll_duration = atof(optarg); break;
+        case 'e': tolerance = atof(optarg); break;
+        case 'V': verify = true; break;
+        default: usage(); return 1;
+        }
+    }
+    if (!output_path || sample_rate < 1 || block < 1 || ({{inputs}} > 0 && !input_path) ||
+        !(chunk_duration > 0) || !(tolerance > 0)) {
+        usage();
+        return 1;
+    }
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    const bool parallel = threads > 1;
+    if (parallel && {{inputs}} == 0) {
+        fprintf(stderr, "The DSP has no input, so its chunks cannot be rendered independently.\n");
+        return 1;
+    }
+    if (parallel && direct) {
+        fprintf(stderr, "The parallel rendering does not write directly, using the page cache.\n");
+        direct = false;
+    }
+
+    InputFile input;
+    size_t input_frames = (size_t)(duration * sample_rate);
+    if (input_path) {
+        if (!input.open(input_path, raw_format, sample_rate, {{inputs}}))
+            return 1;
+        if (input.channels != {{inputs}}) {
+            fprintf(stderr, "The input has %u channels instead of {{inputs}}.\n", input.channels);
+            return 1;
+        }
+        sample_rate = input.sample_rate;
+        input_frames = input.frames;
+    }
+
+    std::unique_ptr<{{Identifier}}> dsp(new {{Identifier}});
+    dsp->init(sample_rate);
+
+    const size_t latency = compensate ? (size_t)std::lround(dsp->latency()) : 0;
+    const size_t total_frames = input_frames + (size_t)(tail * sample_rate) + latency;
+
+    size_t preroll = 0;
+    if (parallel) {
+        if (preroll_duration >= 0)
+            preroll = (size_t)(preroll_duration * sample_rate);
+        else {
+            bool settled = false;
+            preroll = measure_preroll(sample_rate, (float)(1e-2 * tolerance), (size_t)60 * sample_rate, settled);
+            if (!settled)
+                fprintf(stderr, "The DSP does not converge, the pre-roll is limited to 60 s.\n");
+        }
+    }
+
+    const size_t output_frame_bytes = format_info[output_format].bytes * {{outputs}};
+    OutputFile output;
+    if (!output.open(output_path, output_format, {{outputs}}, sample_rate, direct, block * output_frame_bytes))
+        return 1;
+
+    uint64_t start = monotonic_ns();
+    uint64_t dsp_ns = 0;
+
+    if (parallel) {
+        const size_t chunk = std::max<size_t>(1, (size_t)(chunk_duration * sample_rate));
+        if (!render_parallel(input, input_frames, sample_rate, latency, total_frames, block, chunk, preroll,
+                             threads, output, dsp_ns)) {
+            fprintf(stderr, "Cannot write the output file.\n");
+            return 1;
+        }
+        printf("Rendered %zu chunks of %.3f s on %u threads, with a pre-roll of %.3f s\n",
+               (total_frames - latency + chunk - 1) / chunk, (double)chunk / sample_rate, threads,
+               (double)preroll / sample_rate);
+    }
+    else {
+        auto sink = [&](float *const outputs[], size_t frames, size_t) -> bool {
+            write_samples(output.buffer + output.fill, output_format, {{outputs}}, outputs, frames);
+            return output.write(frames * output_frame_bytes);
+        };
+        RenderBuffers buffers(block);
+        if (!render_range(*dsp, input, input_frames, buffers, 0, latency, total_frames, true, dsp_ns, sink)) {
+            fprintf(stderr, "Cannot write the output file.\n");
+            return 1;
+        }
+    }
+
+    if (!output.finish()) {
+        fprintf(stderr, "Cannot write the output file.\n");
+        return 1;
+    }
+
+    const double elapsed = 1e-9 * (monotonic_ns() - start);
+    const double audio = (double)(total_frames - latency) / sample_rate;
+    const double bytes = (double)input_frames * format_info[input.format].bytes * {{inputs}} + (double)output.data_size;
+    printf("Rendered %.3f s of audio in %.3f s, realtime factor %.1f (DSP alone %.1f), %.1f MB/s\n",
+           audio, elapsed, audio / elapsed, audio / (1e-9 * dsp_ns), 1e-6 * bytes / elapsed);
+
+    if (verify) {
+        double error = 0;
+        size_t index = 0;
+        if (!verify_output(output_path, output_format, input, input_frames, sample_rate, latency, total_frames,
+                           block, error, index)) {
+            fprintf(stderr, "Cannot verify the output file.\n");
+            return 1;
+        }
+        printf("Verified against the sequential rendering, largest error %g at %.3f s\n",
+               error, (double)index / sample_rate);
+        if (error > tolerance) {
+            fprintf(stderr, "The error exceeds the tolerance of %g.\n", tolerance);
+            return 1;
+        }
+    }
+
+    return 0;
+}
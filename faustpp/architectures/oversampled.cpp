@@ -1,5 +1,104 @@
 {% extends "generic.cpp" %}
 
+{#
+  The factors below 1 select the undersampled mode, in which the inputs are
+  decimated to run the DSP at a lower rate, and the outputs interpolated.
+#}
+{% set Oversampling = {"1/2": 0.5, "1/4": 0.25}.get(Oversampling, Oversampling) %}
+{% set Undersampling = {0.5: 2, 0.25: 4}.get(Oversampling, 1) %}
+
+{#
+  A DSP which declares its sections with the metadata `oversampling_pre`,
+  `oversampling_core` and `oversampling_post` has only its core oversampled.
+  The pre and post sections, which are optional, run at the normal rate.
+  The controls are found in the sections by their symbol, or else their label.
+#}
+{% set OversamplingSplit = "core" in parts and Oversampling > 1 %}
+{% set CoreInputs = parts.core.inputs if OversamplingSplit else inputs %}
+{% set CoreOutputs = parts.core.outputs if OversamplingSplit else outputs %}
+{% set OversamplingSplitVars = [] %}
+{% if OversamplingSplit %}
+{% for w in active + passive %}
+{% set owners = [] %}
+{% for role in ["pre", "core", "post"] if role in parts %}
+{% for pw in parts[role].active + parts[role].passive
+       if (pw.meta.symbol|default(pw.label)) == (w.meta.symbol|default(w.label)) %}
+{% set _ = owners.append(role ~ "." ~ pw.var) %}
+{% endfor %}
+{% endfor %}
+{% set _ = OversamplingSplitVars.append(owners) %}
+{% endfor %}
+{% endif %}
+
+{#
+  Design of the stages of the cascade, from the lowest rate upwards.
+  Each stage is identified by the factor it reaches. The 2x stages use either
+  kind of filter, and the 3x stages use a third-band FIR filter.
+
+  The attenuation (dB) and the transition band (normalized) can be given per
+  stage as a comma-separated list. If the list is shorter than the cascade,
+  the last attenuation repeats, and the transition band is relaxed for the
+  stages at higher rates.
+#}
+{% set OversamplingCascades = {
+    2: [2], 3: [3], 4: [2, 4], 6: [2, 6], 8: [2, 4, 8], 16: [2, 4, 8, 16],
+    0.5: [2], 0.25: [2, 4],
+} %}
+{% set OversamplingQualities = {
+    "draft": [60, 0.1],
+    "standard": [100, 0.01],
+    "high": [120, 0.005],
+} %}
+{% set OversamplingQuality = OversamplingQuality|default("standard") %}
+{% set OversamplingFilter = OversamplingFilter|default("iir") %}
+{% set OversamplingStages = [] %}
+{% set OversamplingLatency = namespace(value=0.0) %}
+{% if Oversampling in OversamplingCascades and OversamplingQuality in OversamplingQualities and
+      OversamplingFilter in ["iir", "fir"] %}
+{% set quality = OversamplingQualities[OversamplingQuality] %}
+{% set attenuations = (OversamplingAttenuation|default(quality[0]))|string %}
+{% set attenuations = attenuations.split(",")|map("float")|list %}
+{% set transitions = (OversamplingTransition|default(quality[1]))|string %}
+{% set transitions = transitions.split(",")|map("float")|list %}
+{% set stage = namespace(transition=0.0, previous=1) %}
+{% for factor in OversamplingCascades[Oversampling] %}
+{% set index = loop.index0 %}
+{% set ratio = factor // stage.previous %}
+{% set attenuation = attenuations[index] if index < attenuations|length else attenuations[-1] %}
+{% if index < transitions|length %}
+{% set stage.transition = transitions[index] %}
+{% else %}
+{% set stage.transition = hiir.next_stage_transition(stage.transition) %}
+{% endif %}
+{% set frames = "%d * MaximumFrames"|format(stage.previous) if Undersampling == 1 else "MaximumFrames" %}
+{% if ratio == 3 %}
+{# the same band edges relative to the lower rate, as for the 2x stages #}
+{% set coefs = fir.compute_thirdband_coefs(attenuation, 2 * stage.transition / 3) %}
+{% set delay = fir.compute_thirdband_delay(coefs) %}
+{% set up = "ThirdbandFirUpsampler<%d, %s>"|format(coefs|length, frames) %}
+{% set down = "ThirdbandFirDownsampler<%d, %s>"|format(coefs|length, frames) %}
+{% elif OversamplingFilter == "fir" %}
+{% set coefs = fir.compute_halfband_coefs(attenuation, stage.transition) %}
+{% set delay = fir.compute_halfband_delay(coefs) %}
+{% set up = "HalfbandFirUpsampler<%d, %s>"|format(coefs|length, frames) %}
+{% set down = "HalfbandFirDownsampler<%d, %s>"|format(coefs|length, frames) %}
+{% else %}
+{% set coefs = hiir.compute_coefs(attenuation, stage.transition) %}
+{% set delay = hiir.compute_halfband_delay(coefs) %}
+{% set up = "hiir::Upsampler2xFpu<%d>"|format(coefs|length) %}
+{% set down = "hiir::Downsampler2xFpu<%d>"|format(coefs|length) %}
+{% endif %}
+{# the up and down filters both delay by this amount, at the rate of the stage #}
+{% set OversamplingLatency.value = OversamplingLatency.value + 2 * delay * Undersampling / factor %}
+{% set count = "count" if stage.previous == 1 else "%d * count"|format(stage.previous) %}
+{% set _ = OversamplingStages.append({"factor": factor, "ratio": ratio, "coefs": coefs,
+                                      "up": up, "down": down, "count": count}) %}
+{% set stage.previous = factor %}
+{% endfor %}
+{# the samples held to complete a frame at the reduced rate #}
+{% set OversamplingLatency.value = OversamplingLatency.value + Undersampling - 1 %}
+{% endif %}
+
 {% block ImplementationDescription %}
 {{super()}}
 //------------------------------------------------------------------------------
@@ -33,103 +132,411 @@
 
 {% block ImplementationPrologue %}
 {{super()}}
-{% if not (Oversampling in [1, 2, 4, 8, 16]) %}
-{{fail("`Oversampling` is invalid, accepted values are [1, 2, 4, 8, 16].")}}
+{% if not (Oversampling in [1, 2, 3, 4, 6, 8, 16, 0.5, 0.25]) %}
+{{fail("`Oversampling` is invalid, accepted values are [1, 2, 3, 4, 6, 8, 16, 1/2, 1/4].")}}
+{% endif %}
+{% if not (OversamplingQuality in OversamplingQualities) %}
+{{fail("`OversamplingQuality` is invalid, accepted values are [draft, standard, high].")}}
+{% endif %}
+{% if not (OversamplingFilter in ["iir", "fir"]) %}
+{{fail("`OversamplingFilter` is invalid, accepted values are [iir, fir].")}}
+{% endif %}
+{% if OversamplingSplit %}
+{% if CoreInputs != (parts.pre.outputs if "pre" in parts else inputs) %}
+{{fail("The inputs of the `oversampling_core` section do not match the section before it.")}}
+{% endif %}
+{% if CoreOutputs != (parts.post.inputs if "post" in parts else outputs) %}
+{{fail("The outputs of the `oversampling_core` section do not match the section after it.")}}
+{% endif %}
+{% for owners in OversamplingSplitVars if owners|length == 0 %}
+{{fail("A control is not found in any of the oversampling sections.")}}
+{% endfor %}
 {% endif %}
 {% endblock %}
 
 {% block ImplementationIncludeExtra %}
 {{super()}}
-{% if Oversampling != 1 %}
+{% if Oversampling != 1 and (OversamplingFilter == "fir" or Oversampling in [3, 6] or Undersampling != 1) %}
+#include <algorithm>
+{% endif %}
+{% if Oversampling != 1 and OversamplingFilter == "iir" and Oversampling != 3 %}
 #include "hiir/Upsampler2xFpu.h"
 #include "hiir/Downsampler2xFpu.h"
 {% endif %}
 {% endblock %}
 
 {% block ImplementationFaustCode %}
+{% if Undersampling != 1 %}
+static constexpr float gOversampling = {{Oversampling}}f;
+{% else %}
 enum { gOversampling = {{Oversampling}} };
+{% endif %}
+{% if OversamplingSplit %}
+{% for role in ["pre", "core", "post"] if role in parts %}
+{{parts[role].class_code}}
+{% endfor %}
+
+namespace {
+
+struct {{class_name}}_sections : {{Identifier}}::BasicDsp {
+    {% for role in ["pre", "core", "post"] if role in parts %}
+    {{parts[role].class_name}} {{role}};
+    {% endfor %}
+};
+
+} // namespace
+{% else %}
 {{super()}}
+{% endif %}
 {% endblock %}
 
 {% block ImplementationBeforeClassDefs %}
 {{super()}}
 {% if Oversampling != 1 %}
 static constexpr unsigned MaximumFrames = {{MaximumFrames|default(512)}};
+{% if Undersampling != 1 %}
+static constexpr unsigned Undersampling = {{Undersampling}};
+{% endif %}
+{% if OversamplingFilter == "fir" or Oversampling in [3, 6] %}
+
+namespace {
+
+// Half-band linear-phase FIR filters in polyphase form.
+//
+// The filter has 4*NC-1 taps. The taps at an odd distance from the center are
+// zero, except the center which is 1/2, so one of the polyphase branches is a
+// pure delay. The other branch has 2*NC taps, which are symmetric, and only
+// NC of them are stored.
+//
+// The block is filtered one tap at a time, so the inner loops run over
+// contiguous samples and vectorize.
+
+template <unsigned NC, unsigned MaxFrames>
+class HalfbandFirUpsampler {
+public:
+    enum { NBR_COEFS = NC };
+
+    void set_coefs(const double coefs[])
+    {
+        for (unsigned i = 0; i < NC; ++i)
+            fCoefs[i] = static_cast<float>(2 * coefs[i]);
+    }
+
+    void clear_buffers()
+    {
+        std::fill(fHistory, fHistory + 2 * NC - 1, 0.0f);
+    }
+
+    void process_block(float out[], const float in[], unsigned count)
+    {
+        float *x = fHistory + 2 * NC - 1;
+        float *acc = fAccum;
+        std::copy(in, in + count, x);
+        std::fill(acc, acc + count, 0.0f);
+
+        for (unsigned i = 0; i < NC; ++i) {
+            const float c = fCoefs[i];
+            const float *x1 = x - i;
+            const float *x2 = x - (2 * NC - 1 - i);
+            for (unsigned n = 0; n < count; ++n)
+                acc[n] += c * (x1[n] + x2[n]);
+        }
+
+        const float *xc = x - (NC - 1);
+        for (unsigned n = 0; n < count; ++n) {
+            out[2 * n] = acc[n];
+            out[2 * n + 1] = xc[n];
+        }
+
+        std::copy(x + count - (2 * NC - 1), x + count, fHistory);
+    }
+
+private:
+    float fCoefs[NC];
+    float fHistory[2 * NC - 1 + MaxFrames];
+    float fAccum[MaxFrames];
+};
+
+template <unsigned NC, unsigned MaxFrames>
+class HalfbandFirDownsampler {
+public:
+    enum { NBR_COEFS = NC };
+
+    void set_coefs(const double coefs[])
+    {
+        for (unsigned i = 0; i < NC; ++i)
+            fCoefs[i] = static_cast<float>(coefs[i]);
+    }
+
+    void clear_buffers()
+    {
+        std::fill(fEven, fEven + 2 * NC - 1, 0.0f);
+        std::fill(fOdd, fOdd + NC, 0.0f);
+    }
+
+    void process_block(float out[], const float in[], unsigned count)
+    {
+        float *xe = fEven + 2 * NC - 1;
+        float *xo = fOdd + NC;
+        for (unsigned n = 0; n < count; ++n) {
+            xe[n] = in[2 * n];
+            xo[n] = in[2 * n + 1];
+        }
+
+        const float *xc = xo - NC;
+        for (unsigned n = 0; n < count; ++n)
+            out[n] = 0.5f * xc[n];
+
+        for (unsigned i = 0; i < NC; ++i) {
+            const float c = fCoefs[i];
+            const float *x1 = xe - i;
+            const float *x2 = xe - (2 * NC - 1 - i);
+            for (unsigned n = 0; n < count; ++n)
+                out[n] += c * (x1[n] + x2[n]);
+        }
+
+        std::copy(xe + count - (2 * NC - 1), xe + count, fEven);
+        std::copy(xo + count - NC, xo + count, fOdd);
+    }
+
+private:
+    float fCoefs[NC];
+    float fEven[2 * NC - 1 + MaxFrames];
+    float fOdd[NC + MaxFrames];
+};
+
+// Third-band linear-phase FIR filters in polyphase form.
+//
+// The filter has 3*NC-1 taps. The taps at a distance from the center which is
+// a multiple of 3 are zero, except the center which is 1/3, so one of the
+// polyphase branches is a pure delay. The two other branches have NC taps,
+// each being the reverse of the other, and only the first is stored.
+
+template <unsigned NC, unsigned MaxFrames>
+class ThirdbandFirUpsampler {
+public:
+    enum { NBR_COEFS = NC };
+
+    void set_coefs(const double coefs[])
+    {
+        for (unsigned i = 0; i < NC; ++i)
+            fCoefs[i] = static_cast<float>(3 * coefs[i]);
+    }
+
+    void clear_buffers()
+    {
+        std::fill(fHistory, fHistory + NC - 1, 0.0f);
+    }
+
+    void process_block(float out[], const float in[], unsigned count)
+    {
+        float *x = fHistory + NC - 1;
+        float *acc0 = fAccum[0];
+        float *acc1 = fAccum[1];
+        std::copy(in, in + count, x);
+        std::fill(acc0, acc0 + count, 0.0f);
+        std::fill(acc1, acc1 + count, 0.0f);
+
+        for (unsigned i = 0; i < NC; ++i) {
+            const float c = fCoefs[i];
+            const float *x0 = x - i;
+            const float *x1 = x - (NC - 1 - i);
+            for (unsigned n = 0; n < count; ++n) {
+                acc0[n] += c * x0[n];
+                acc1[n] += c * x1[n];
+            }
+        }
+
+        const float *xc = x - (NC / 2 - 1);
+        for (unsigned n = 0; n < count; ++n) {
+            out[3 * n] = acc0[n];
+            out[3 * n + 1] = acc1[n];
+            out[3 * n + 2] = xc[n];
+        }
+
+        std::copy(x + count - (NC - 1), x + count, fHistory);
+    }
+
+private:
+    float fCoefs[NC];
+    float fHistory[NC - 1 + MaxFrames];
+    float fAccum[2][MaxFrames];
+};
+
+template <unsigned NC, unsigned MaxFrames>
+class ThirdbandFirDownsampler {
+public:
+    enum { NBR_COEFS = NC };
+
+    void set_coefs(const double coefs[])
+    {
+        for (unsigned i = 0; i < NC; ++i)
+            fCoefs[i] = static_cast<float>(coefs[i]);
+    }
+
+    void clear_buffers()
+    {
+        std::fill(fPhase0, fPhase0 + NC - 1, 0.0f);
+        std::fill(fPhase1, fPhase1 + NC / 2, 0.0f);
+        std::fill(fPhase2, fPhase2 + NC, 0.0f);
+    }
+
+    void process_block(float out[], const float in[], unsigned count)
+    {
+        float *x0 = fPhase0 + NC - 1;
+        float *x1 = fPhase1 + NC / 2;
+        float *x2 = fPhase2 + NC;
+        for (unsigned n = 0; n < count; ++n) {
+            x0[n] = in[3 * n];
+            x1[n] = in[3 * n + 1];
+            x2[n] = in[3 * n + 2];
+        }
+
+        const float *xc = x1 - NC / 2;
+        for (unsigned n = 0; n < count; ++n)
+            out[n] = (1.0f / 3.0f) * xc[n];
+
+        for (unsigned i = 0; i < NC; ++i) {
+            const float c = fCoefs[i];
+            const float *y0 = x0 - i;
+            const float *y2 = x2 - (NC - i);
+            for (unsigned n = 0; n < count; ++n)
+                out[n] += c * (y0[n] + y2[n]);
+        }
+
+        std::copy(x0 + count - (NC - 1), x0 + count, fPhase0);
+        std::copy(x1 + count - NC / 2, x1 + count, fPhase1);
+        std::copy(x2 + count - NC, x2 + count, fPhase2);
+    }
+
+private:
+    float fCoefs[NC];
+    float fPhase0[NC - 1 + MaxFrames];
+    float fPhase1[NC / 2 + MaxFrames];
+    float fPhase2[NC + MaxFrames];
+};
+
+} // namespace
+{% endif %}
 
 struct {{Identifier}}::Oversampler {
     struct Up {
-        hiir::Upsampler2xFpu<12> f2x;
-        {% if Oversampling >= 4 %}hiir::Upsampler2xFpu<4> f4x;{% endif %}
-        {% if Oversampling >= 8 %}hiir::Upsampler2xFpu<3> f8x;{% endif %}
-        {% if Oversampling >= 16 %}hiir::Upsampler2xFpu<2> f16x;{% endif %}
+        {% for stage in OversamplingStages %}
+        {{stage.up}} f{{stage.factor}}x;
+        {% endfor %}
     };
     struct Down {
-        {% if Oversampling >= 16 %}hiir::Downsampler2xFpu<2> f16x;{% endif %}
-        {% if Oversampling >= 8 %}hiir::Downsampler2xFpu<3> f8x;{% endif %}
-        {% if Oversampling >= 4 %}hiir::Downsampler2xFpu<4> f4x;{% endif %}
-        hiir::Downsampler2xFpu<12> f2x;
+        {% for stage in OversamplingStages|reverse %}
+        {{stage.down}} f{{stage.factor}}x;
+        {% endfor %}
     };
-    Up fUpsampler[{{inputs}}];
-    Down fDownsampler[{{outputs}}];
-    float fWorkBuffer[({{inputs + outputs}}) * (2 * gOversampling * MaximumFrames)];
+{% if Undersampling == 1 %}
+    Up fUpsampler[{{CoreInputs}}];
+    Down fDownsampler[{{CoreOutputs}}];
+    float fWorkBuffer[({{CoreInputs + CoreOutputs}}) * (2 * gOversampling * MaximumFrames)];
+{% if OversamplingSplit and ("pre" in parts or "post" in parts) %}
+    // the signals between the core and the sections at the normal rate
+    float fSplitBuffer[({{CoreInputs + CoreOutputs}}) * MaximumFrames];
+{% endif %}
+{% else %}
+    Down fDownsampler[{{inputs}}];
+    Up fUpsampler[{{outputs}}];
+    // samples held between calls, until they complete a frame at the reduced rate
+    enum { BufferFrames = MaximumFrames + 2 * Undersampling };
+    float fInputHold[{{inputs}}][Undersampling - 1];
+    float fOutputHold[{{outputs}}][Undersampling - 1];
+    unsigned fInputHeld;
+    float fWorkBuffer[({{inputs + outputs}}) * (2 * BufferFrames)];
+{% endif %}
 };
 
 namespace {
-    static constexpr double sCoefs2x[12] = { 0.036681502163648017, 0.13654762463195794, 0.27463175937945444, 0.42313861743656711, 0.56109869787919531, 0.67754004997416184, 0.76974183386322703, 0.83988962484963892, 0.89226081800387902, 0.9315419599631839, 0.96209454837808417, 0.98781637073289585 };
-    {% if Oversampling >= 4 %}static constexpr double sCoefs4x[4] = {0.041893991997656171, 0.16890348243995201, 0.39056077292116603, 0.74389574826847926 };{% endif %}
-    {% if Oversampling >= 8 %}static constexpr double sCoefs8x[3] = {0.055748680811302048, 0.24305119574153072, 0.64669913119268196 };{% endif %}
-    {% if Oversampling >= 16 %}static constexpr double sCoefs16x[2] = {0.10717745346023573, 0.53091435354504557 };{% endif %}
+    {% for stage in OversamplingStages %}
+    static constexpr double sCoefs{{stage.factor}}x[{{stage.coefs|length}}] = { {% for c in stage.coefs %}{{"%.17g"|format(c)}}{% if not loop.last %}, {% endif %}{% endfor %} };
+    {% endfor %}
 }
 {% endif %}
 {% endblock %}
 
 {% block ImplementationSetupDsp %}
+{% if OversamplingSplit %}
+    {{class_name}}_sections *dsp = new {{class_name}}_sections;
+    fDsp.reset(dsp);
+    {% for role in ["pre", "core", "post"] if role in parts %}
+    dsp->{{role}}.instanceResetUserInterface();
+    {% endfor %}
+{% else %}
     {{super()}}
+{% endif %}
 {% if Oversampling != 1 %}
     Oversampler *ovs = new Oversampler;
     fOversampler.reset(ovs);
-    for (unsigned i = 0; i < {{inputs}}; ++i) {
+    for (unsigned i = 0; i < {{CoreInputs if Undersampling == 1 else outputs}}; ++i) {
         Oversampler::Up &up = ovs->fUpsampler[i];
-        up.f2x.set_coefs(sCoefs2x);
-        {% if Oversampling >= 4 %}up.f4x.set_coefs(sCoefs4x);{% endif %}
-        {% if Oversampling >= 8 %}up.f8x.set_coefs(sCoefs8x);{% endif %}
-        {% if Oversampling >= 16 %}up.f16x.set_coefs(sCoefs16x);{% endif %}
+        {% for stage in OversamplingStages %}
+        up.f{{stage.factor}}x.set_coefs(sCoefs{{stage.factor}}x);
+        {% endfor %}
     }
-    for (unsigned i = 0; i < {{outputs}}; ++i) {
+    for (unsigned i = 0; i < {{CoreOutputs if Undersampling == 1 else inputs}}; ++i) {
         Oversampler::Down &down = ovs->fDownsampler[i];
-        down.f2x.set_coefs(sCoefs2x);
-        {% if Oversampling >= 4 %}down.f4x.set_coefs(sCoefs4x);{% endif %}
-        {% if Oversampling >= 8 %}down.f8x.set_coefs(sCoefs8x);{% endif %}
-        {% if Oversampling >= 16 %}down.f16x.set_coefs(sCoefs16x);{% endif %}
+        {% for stage in OversamplingStages %}
+        down.f{{stage.factor}}x.set_coefs(sCoefs{{stage.factor}}x);
+        {% endfor %}
     }
 {% endif %}
 {% endblock %}
 
+{% block ImplementationInitDsp %}
+{% if OversamplingSplit %}
+    {{class_name}}_sections &dsp = static_cast<{{class_name}}_sections &>(*fDsp);
+    {% for role in ["pre", "core", "post"] if role in parts %}
+    dsp.{{role}}.classInit(sample_rate);
+    dsp.{{role}}.instanceConstants(sample_rate);
+    {% endfor %}
+    clear();
+{% else %}
+    {{super()}}
+{% endif %}
+{% endblock %}
+
 {% block ImplementationClearDsp %}
+{% if OversamplingSplit %}
+    {{class_name}}_sections &dsp = static_cast<{{class_name}}_sections &>(*fDsp);
+    {% for role in ["pre", "core", "post"] if role in parts %}
+    dsp.{{role}}.instanceClear();
+    {% endfor %}
+{% else %}
     {{super()}}
+{% endif %}
 {% if Oversampling != 1 %}
-    for (unsigned i = 0; i < {{inputs}}; ++i) {
+    for (unsigned i = 0; i < {{CoreInputs if Undersampling == 1 else outputs}}; ++i) {
         Oversampler::Up &up = fOversampler->fUpsampler[i];
-        up.f2x.clear_buffers();
-        {% if Oversampling >= 4 %}up.f4x.clear_buffers();{% endif %}
-        {% if Oversampling >= 8 %}up.f8x.clear_buffers();{% endif %}
-        {% if Oversampling >= 16 %}up.f16x.clear_buffers();{% endif %}
+        {% for stage in OversamplingStages %}
+        up.f{{stage.factor}}x.clear_buffers();
+        {% endfor %}
     }
-    for (unsigned i = 0; i < {{outputs}}; ++i) {
+    for (unsigned i = 0; i < {{CoreOutputs if Undersampling == 1 else inputs}}; ++i) {
         Oversampler::Down &down = fOversampler->fDownsampler[i];
-        down.f2x.clear_buffers();
-        {% if Oversampling >= 4 %}down.f4x.clear_buffers();{% endif %}
-        {% if Oversampling >= 8 %}down.f8x.clear_buffers();{% endif %}
-        {% if Oversampling >= 16 %}down.f16x.clear_buffers();{% endif %}
+        {% for stage in OversamplingStages %}
+        down.f{{stage.factor}}x.clear_buffers();
+        {% endfor %}
     }
 {% endif %}
+{% if Undersampling != 1 %}
+    for (unsigned i = 0; i < {{inputs}}; ++i)
+        std::fill(fOversampler->fInputHold[i], fOversampler->fInputHold[i] + Undersampling - 1, 0.0f);
+    for (unsigned i = 0; i < {{outputs}}; ++i)
+        std::fill(fOversampler->fOutputHold[i], fOversampler->fOutputHold[i] + Undersampling - 1, 0.0f);
+    fOversampler->fInputHeld = 0;
+{% endif %}
 {% endblock %}
 
 {% block ImplementationProcessDsp %}
 {% if Oversampling != 1 %}
-    for (unsigned index = 0; index < count; ++index) {
-        unsigned left = count - index;
-        unsigned segment = (left < MaximumFrames) ? left : MaximumFrames;
+    for (unsigned index = 0; index < count;) {
+        unsigned segment = count - index;
+        if (segment > MaximumFrames)
+            segment = MaximumFrames;
         const float *inputs[] = {
             {% for i in range(inputs) %}in{{i}} + index,{% endfor %}
         };
@@ -144,41 +551,248 @@ namespace {
 {% endif %}
 {% endblock %}
 
-{% block ImplementationEpilogue %}
+{% block ImplementationGetParameter %}
+{% if OversamplingSplit %}
+    {{class_name}}_sections &dsp = static_cast<{{class_name}}_sections &>(*fDsp);
+    switch (index) {
+    {% for w in active + passive %}
+    case {{loop.index0}}:
+        return dsp.{{OversamplingSplitVars[loop.index0][0]}};
+    {% endfor %}
+    default:
+        (void)dsp;
+        return 0;
+    }
+{% else %}
+    {{super()}}
+{% endif %}
+{% endblock %}
+
+{% block ImplementationSetParameter %}
+{% if OversamplingSplit %}
+    {{class_name}}_sections &dsp = static_cast<{{class_name}}_sections &>(*fDsp);
+    switch (index) {
+    {% for w in active %}
+    case {{loop.index0}}:
+        {% for var in OversamplingSplitVars[loop.index0] %}
+        dsp.{{var}} = value;
+        {% endfor %}
+        break;
+    {% endfor %}
+    default:
+        (void)dsp;
+        (void)value;
+        break;
+    }
+{% else %}
+    {{super()}}
+{% endif %}
+{% endblock %}
+
+{% block ImplementationGetWidget %}
+{% if OversamplingSplit %}
+    {{class_name}}_sections &dsp = static_cast<{{class_name}}_sections &>(*fDsp);
+    return dsp.{{OversamplingSplitVars[loop.index0][0]}};
+{% else %}
+    {{super()}}
+{% endif %}
+{% endblock %}
+
+{% block ImplementationSetWidget %}
+{% if OversamplingSplit %}
+    {{class_name}}_sections &dsp = static_cast<{{class_name}}_sections &>(*fDsp);
+    {% for var in OversamplingSplitVars[loop.index0] %}
+    dsp.{{var}} = value;
+    {% endfor %}
+{% else %}
+    {{super()}}
+{% endif %}
+{% endblock %}
+
+{% block ImplementationLatency %}
 {% if Oversampling != 1 %}
+    return {{"%.6g"|format(OversamplingLatency.value)}};
+{% else %}
+    {{super()}}
+{% endif %}
+{% endblock %}
+
+{% block ImplementationEpilogue %}
+{% if Undersampling != 1 %}
 void {{Identifier}}::process_segment(const float *const inputs[], float *const outputs[], unsigned count) noexcept
 {
+{% if Trace|default(0) %}
+    TraceScope trace("{{Identifier}}::process_segment", fTraceInstance, count);
+{% endif %}
     {{class_name}} &dsp = static_cast<{{class_name}} &>(*fDsp);
-    float *inputsUp[{{inputs}}];
-    float *outputsUp[{{outputs}}];
+    Oversampler &ovs = *fOversampler;
+    const unsigned bufferFrames = Oversampler::BufferFrames;
+    float *inputsDown[{{inputs}}];
+    float *outputsDown[{{outputs}}];
+
+    unsigned held = ovs.fInputHeld;
+    unsigned total = held + count;
+    unsigned countDown = total / Undersampling;
+    unsigned pending = Undersampling - 1 - held;
 
     for (unsigned channel = 0; channel < {{inputs}}; ++channel) {
-        Oversampler::Up &up = fOversampler->fUpsampler[channel];
-        float *curr = &fOversampler->fWorkBuffer[channel * (2 * gOversampling * MaximumFrames)];
-        float *temp = curr + gOversampling * MaximumFrames;
-        up.f2x.process_block(curr, inputs[channel], count); std::swap(curr, temp);
-        {% if Oversampling >= 4 %}up.f4x.process_block(curr, temp, 2 * count); std::swap(curr, temp);{% endif %}
-        {% if Oversampling >= 8 %}up.f8x.process_block(curr, temp, 4 * count); std::swap(curr, temp);{% endif %}
-        {% if Oversampling >= 16 %}up.f16x.process_block(curr, temp, 8 * count); std::swap(curr, temp);{% endif %}
-        inputsUp[channel] = temp;
+        Oversampler::Down &down = ovs.fDownsampler[channel];
+        float *curr = &ovs.fWorkBuffer[channel * (2 * bufferFrames)];
+        float *temp = curr + bufferFrames;
+        float *hold = ovs.fInputHold[channel];
+        std::copy(hold, hold + held, curr);
+        std::copy(inputs[channel], inputs[channel] + count, curr + held);
+        std::copy(curr + Undersampling * countDown, curr + total, hold);
+        if (countDown > 0) {
+            {% for stage in OversamplingStages|reverse %}
+            down.f{{stage.factor}}x.process_block(temp, curr, {{stage.count|replace("count", "countDown")}}); std::swap(curr, temp);
+            {% endfor %}
+        }
+        inputsDown[channel] = curr;
     }
 
     for (unsigned channel = 0; channel < {{outputs}}; ++channel) {
-        float *curr = &fOversampler->fWorkBuffer[(channel + {{inputs}}) * (2 * gOversampling * MaximumFrames)];
-        outputsUp[channel] = curr;
+        float *curr = &ovs.fWorkBuffer[(channel + {{inputs}}) * (2 * bufferFrames)];
+        outputsDown[channel] = curr;
     }
 
-    dsp.compute(gOversampling * count, inputsUp, outputsUp);
+{% if Trace|default(0) %}
+    {
+        TraceScope trace("{{Identifier}}::compute", fTraceInstance, countDown);
+        dsp.compute(countDown, inputsDown, outputsDown);
+    }
+{% else %}
+    dsp.compute(countDown, inputsDown, outputsDown);
+{% endif %}
 
     for (unsigned channel = 0; channel < {{outputs}}; ++channel) {
-        Oversampler::Down &down = fOversampler->fDownsampler[channel];
-        float *curr = outputsUp[channel];
-        {% if Oversampling > 2 %}float *temp = curr + gOversampling * MaximumFrames;{% endif %}
-        {% if Oversampling >= 16 %}down.f16x.process_block(temp, curr, 8 * count); std::swap(curr, temp);{% endif %}
-        {% if Oversampling >= 8 %}down.f8x.process_block(temp, curr, 4 * count); std::swap(curr, temp);{% endif %}
-        {% if Oversampling >= 4 %}down.f4x.process_block(temp, curr, 2 * count); std::swap(curr, temp);{% endif %}
-        down.f2x.process_block(outputs[channel], curr, count);
+        Oversampler::Up &up = ovs.fUpsampler[channel];
+        float *curr = outputsDown[channel];
+        float *temp = curr + bufferFrames;
+        float *hold = ovs.fOutputHold[channel];
+        {% if OversamplingStages|length > 1 %}
+        if (countDown > 0) {
+            {% for stage in OversamplingStages[:-1] %}
+            up.f{{stage.factor}}x.process_block(temp, curr, {{stage.count|replace("count", "countDown")}}); std::swap(curr, temp);
+            {% endfor %}
+        }
+        {% endif %}
+        std::copy(hold, hold + pending, temp);
+        if (countDown > 0)
+            up.f{{Undersampling}}x.process_block(temp + pending, curr, {{OversamplingStages[-1].count|replace("count", "countDown")}});
+        std::copy(temp, temp + count, outputs[channel]);
+        std::copy(temp + count, temp + pending + Undersampling * countDown, hold);
+    }
+
+    ovs.fInputHeld = total - Undersampling * countDown;
+}
+{% elif Oversampling != 1 %}
+{% set CoreSource = "inputsCore" if OversamplingSplit and "pre" in parts else "inputs" %}
+{% set CoreTarget = "outputsCore" if OversamplingSplit and "post" in parts else "outputs" %}
+void {{Identifier}}::process_segment(const float *const inputs[], float *const outputs[], unsigned count) noexcept
+{
+{% if Trace|default(0) %}
+    TraceScope trace("{{Identifier}}::process_segment", fTraceInstance, count);
+{% endif %}
+{% if OversamplingSplit %}
+    {{class_name}}_sections &dsp = static_cast<{{class_name}}_sections &>(*fDsp);
+{% else %}
+    {{class_name}} &dsp = static_cast<{{class_name}} &>(*fDsp);
+{% endif %}
+    float *inputsUp[{{CoreInputs}}];
+    float *outputsUp[{{CoreOutputs}}];
+{% if CoreSource == "inputsCore" %}
+
+    float *inputsCore[{{CoreInputs}}];
+    for (unsigned channel = 0; channel < {{CoreInputs}}; ++channel)
+        inputsCore[channel] = &fOversampler->fSplitBuffer[channel * MaximumFrames];
+    dsp.pre.compute(count, const_cast<float **>(inputs), inputsCore);
+{% endif %}
+{% if CoreTarget == "outputsCore" %}
+
+    float *outputsCore[{{CoreOutputs}}];
+    for (unsigned channel = 0; channel < {{CoreOutputs}}; ++channel)
+        outputsCore[channel] = &fOversampler->fSplitBuffer[(channel + {{CoreInputs}}) * MaximumFrames];
+{% endif %}
+
+    for (unsigned channel = 0; channel < {{CoreInputs}}; ++channel) {
+        float *curr = &fOversampler->fWorkBuffer[channel * (2 * gOversampling * MaximumFrames)];
+        upsample(channel, {{CoreSource}}[channel], curr, count);
+        inputsUp[channel] = curr;
+    }
+
+    for (unsigned channel = 0; channel < {{CoreOutputs}}; ++channel) {
+        float *curr = &fOversampler->fWorkBuffer[(channel + {{CoreInputs}}) * (2 * gOversampling * MaximumFrames)];
+        outputsUp[channel] = curr;
+    }
+
+{% if Trace|default(0) %}
+    {
+        TraceScope trace("{{Identifier}}::compute", fTraceInstance, gOversampling * count);
+        dsp{{".core" if OversamplingSplit}}.compute(gOversampling * count, inputsUp, outputsUp);
     }
+{% else %}
+    dsp{{".core" if OversamplingSplit}}.compute(gOversampling * count, inputsUp, outputsUp);
+{% endif %}
+
+    for (unsigned channel = 0; channel < {{CoreOutputs}}; ++channel)
+        downsample(channel, outputsUp[channel], {{CoreTarget}}[channel], count);
+{% if CoreTarget == "outputsCore" %}
+
+    dsp.post.compute(count, outputsCore, const_cast<float **>(outputs));
+{% endif %}
 }
+
+{#
+  The stages alternate between the halves of the work buffer of the channel,
+  such that the last one writes to the output. The first half may also be the
+  output, or the input, which is how `process_segment` calls these.
+#}
+void {{Identifier}}::upsample(unsigned channel, const float *in, float *out, unsigned count) noexcept
+{
+    Oversampler::Up &up = fOversampler->fUpsampler[channel];
+    float *curr = &fOversampler->fWorkBuffer[channel * (2 * gOversampling * MaximumFrames)];
+    float *temp = curr + gOversampling * MaximumFrames;
+    {% for stage in OversamplingStages %}
+    {% set target = "out" if loop.revindex0 == 0 else ("temp" if loop.revindex0 is odd else "curr") %}
+    {% set source = "in" if loop.first else ("temp" if loop.revindex0 is even else "curr") %}
+    up.f{{stage.factor}}x.process_block({{target}}, {{source}}, {{stage.count}});
+    {% endfor %}
+    {% if OversamplingStages|length < 3 %}
+    (void)curr;
+    {% endif %}
+    {% if OversamplingStages|length < 2 %}
+    (void)temp;
+    {% endif %}
+}
+
+void {{Identifier}}::downsample(unsigned channel, const float *in, float *out, unsigned count) noexcept
+{
+    Oversampler::Down &down = fOversampler->fDownsampler[channel];
+    float *curr = &fOversampler->fWorkBuffer[(channel + {{CoreInputs}}) * (2 * gOversampling * MaximumFrames)];
+    float *temp = curr + gOversampling * MaximumFrames;
+    {% for stage in OversamplingStages|reverse %}
+    {% set target = "out" if loop.last else ("temp" if loop.index0 is even else "curr") %}
+    {% set source = "in" if loop.first else ("temp" if loop.index0 is odd else "curr") %}
+    down.f{{stage.factor}}x.process_block({{target}}, {{source}}, {{stage.count}});
+    {% endfor %}
+    {% if OversamplingStages|length < 3 %}
+    (void)curr;
+    {% endif %}
+    {% if OversamplingStages|length < 2 %}
+    (void)temp;
+    {% endif %}
+}
+{% if not OversamplingSplit %}
+
+void {{Identifier}}::process_oversampled(const float *const inputs[], float *const outputs[], unsigned count) noexcept
+{
+{% if Trace|default(0) %}
+    TraceScope trace("{{Identifier}}::compute", fTraceInstance, count);
+{% endif %}
+    {{class_name}} &dsp = static_cast<{{class_name}} &>(*fDsp);
+    dsp.compute(count, const_cast<float **>(inputs), const_cast<float **>(outputs));
+}
+{% endif %}
 {% endif %}
 {% endblock %}
@@ -1,18 +1,198 @@
 {% extends "generic.hpp" %}
 
+{% set Oversampling = {"1/2": 0.5, "1/4": 0.25}.get(Oversampling, Oversampling) %}
+{% set OversamplingSplit = "core" in parts and Oversampling > 1 %}
+
 {% block HeaderPrologue %}
 {{super()}}
-{% if not (Oversampling in [1, 2, 4, 8, 16]) %}
-{{fail("`Oversampling` is invalid, accepted values are [1, 2, 4, 8, 16].")}}
+{% if not (Oversampling in [1, 2, 3, 4, 6, 8, 16, 0.5, 0.25]) %}
+{{fail("`Oversampling` is invalid, accepted values are [1, 2, 3, 4, 6, 8, 16, 1/2, 1/4].")}}
 {% endif %}
 {% endblock %}
 
+{% block ClassCapacityDecls %}
+{% if OversamplingSplit %}
+{% set sections = [] %}
+{% for role in ["pre", "core", "post"] if role in parts %}
+{% set _ = sections.append(parts[role].capacity) %}
+{% endfor %}
+    // the estimates of the resources of the Faust code, per instance, except
+    // the tables which are shared, and per frame at the normal rate for the
+    // operations, which do not include the resampling filters
+    static constexpr std::size_t StateBytes = {{sections|sum(attribute="state_bytes")}};
+    static constexpr std::size_t DelayBytes = {{sections|sum(attribute="delay_bytes")}};
+    static constexpr std::size_t TableBytes = {{sections|sum(attribute="table_bytes")}};
+    static constexpr std::size_t OpsPerSample = {{(sections|sum(attribute="ops_per_sample")) + (Oversampling - 1) * parts.core.capacity.ops_per_sample}};
+    static constexpr std::size_t CallsPerSample = {{(sections|sum(attribute="calls_per_sample")) + (Oversampling - 1) * parts.core.capacity.calls_per_sample}};
+{% else %}
+    // the estimates of the resources of the Faust code, per instance, except
+    // the tables which are shared, and per frame at the normal rate for the
+    // operations, which do not include the resampling filters
+    static constexpr std::size_t StateBytes = {{capacity.state_bytes}};
+    static constexpr std::size_t DelayBytes = {{capacity.delay_bytes}};
+    static constexpr std::size_t TableBytes = {{capacity.table_bytes}};
+    static constexpr std::size_t OpsPerSample = {{(Oversampling * capacity.ops_per_sample)|round|int}};
+    static constexpr std::size_t CallsPerSample = {{(Oversampling * capacity.calls_per_sample)|round|int}};
+{% endif %}
+
+{% endblock %}
+
 {% block ClassExtraDecls %}
-{% if Oversampling >= 2 %}
+{% if Oversampling > 1 and not OversamplingSplit %}
+public:
+    enum { Oversampling = {{Oversampling}} };
+    enum { MaximumFrames = {{MaximumFrames|default(512)}} };
+
+    // process the signals at the internal rate, `count` being the number of
+    // frames at this rate
+    void process_oversampled(const float *const inputs[], float *const outputs[], unsigned count) noexcept;
+
+    // convert a channel to or from the internal rate, `count` being the number
+    // of frames at the normal rate, not above `MaximumFrames`
+    void upsample(unsigned channel, const float *in, float *out, unsigned count) noexcept;
+    void downsample(unsigned channel, const float *in, float *out, unsigned count) noexcept;
+
+{% endif %}
+{% if Oversampling != 1 %}
 private:
     void process_segment(const float *const inputs[], float *const outputs[], unsigned count) noexcept;
+{% if OversamplingSplit %}
+    void upsample(unsigned channel, const float *in, float *out, unsigned count) noexcept;
+    void downsample(unsigned channel, const float *in, float *out, unsigned count) noexcept;
+{% endif %}
 
     struct Oversampler;
     std::unique_ptr<Oversampler> fOversampler;
 {% endif %}
 {% endblock %}
+
+{% block HeaderEpilogue %}
+{{super()}}
+{% if Oversampling > 1 and not OversamplingSplit %}
+#ifndef FAUSTPP_OVERSAMPLED_CHAIN_DEFINED
+#define FAUSTPP_OVERSAMPLED_CHAIN_DEFINED
+
+#include <tuple>
+#include <type_traits>
+
+// A chain of oversampled DSPs, which all run at the same internal rate.
+// The signal is upsampled once by the first DSP of the chain, and downsampled
+// once by the last, instead of making the round trip between each pair.
+
+constexpr unsigned oversampled_chain_max(unsigned a)
+{
+    return a;
+}
+
+template <class... T>
+constexpr unsigned oversampled_chain_max(unsigned a, unsigned b, T... rest)
+{
+    return oversampled_chain_max((a > b) ? a : b, rest...);
+}
+
+template <class... Dsp>
+class OversampledChain {
+    typedef std::tuple<Dsp...> Tuple;
+    enum { Size = sizeof...(Dsp) };
+
+public:
+    typedef typename std::tuple_element<0, Tuple>::type Head;
+    typedef typename std::tuple_element<Size - 1, Tuple>::type Tail;
+
+    enum { NumInputs = Head::NumInputs };
+    enum { NumOutputs = Tail::NumOutputs };
+    enum { Oversampling = Head::Oversampling };
+    enum { MaximumFrames = Head::MaximumFrames };
+
+    template <unsigned I>
+    typename std::tuple_element<I, Tuple>::type &dsp() noexcept
+    {
+        return std::get<I>(fDsp);
+    }
+
+    void init(float sample_rate)
+    {
+        init_from(sample_rate, std::integral_constant<unsigned, 0>());
+    }
+
+    void clear() noexcept
+    {
+        clear_from(std::integral_constant<unsigned, 0>());
+    }
+
+    void process(const float *const inputs[], float *const outputs[], unsigned count) noexcept
+    {
+        Head &head = std::get<0>(fDsp);
+        Tail &tail = std::get<Size - 1>(fDsp);
+        float *curr[MaxChannels];
+        float *next[MaxChannels];
+        for (unsigned channel = 0; channel < MaxChannels; ++channel) {
+            curr[channel] = fBuffer[0][channel];
+            next[channel] = fBuffer[1][channel];
+        }
+        for (unsigned index = 0; index < count;) {
+            unsigned segment = count - index;
+            if (segment > MaximumFrames)
+                segment = MaximumFrames;
+            for (unsigned channel = 0; channel < NumInputs; ++channel)
+                head.upsample(channel, inputs[channel] + index, curr[channel], segment);
+            float **result = process_from(curr, next, Oversampling * segment, std::integral_constant<unsigned, 0>());
+            for (unsigned channel = 0; channel < NumOutputs; ++channel)
+                tail.downsample(channel, result[channel], outputs[channel] + index, segment);
+            index += segment;
+        }
+    }
+
+    // the delay of the upsampling filters of the head, and of the
+    // downsampling filters of the tail
+    float latency() const noexcept
+    {
+        return 0.5f * (std::get<0>(fDsp).latency() + std::get<Size - 1>(fDsp).latency());
+    }
+
+private:
+    template <unsigned I>
+    void init_from(float sample_rate, std::integral_constant<unsigned, I>)
+    {
+        std::get<I>(fDsp).init(sample_rate);
+        init_from(sample_rate, std::integral_constant<unsigned, I + 1>());
+    }
+
+    void init_from(float, std::integral_constant<unsigned, Size>) {}
+
+    template <unsigned I>
+    void clear_from(std::integral_constant<unsigned, I>) noexcept
+    {
+        std::get<I>(fDsp).clear();
+        clear_from(std::integral_constant<unsigned, I + 1>());
+    }
+
+    void clear_from(std::integral_constant<unsigned, Size>) noexcept {}
+
+    template <unsigned I>
+    float **process_from(float **curr, float **next, unsigned count, std::integral_constant<unsigned, I>) noexcept
+    {
+        typedef typename std::tuple_element<I, Tuple>::type Current;
+        typedef typename std::tuple_element<(I > 0) ? (I - 1) : 0, Tuple>::type Previous;
+        static_assert(int(Current::Oversampling) == int(Oversampling), "The oversampling ratios do not match.");
+        static_assert(int(Current::MaximumFrames) == int(MaximumFrames), "The maximum frames do not match.");
+        static_assert(I == 0 || int(Previous::NumOutputs) == int(Current::NumInputs), "The channels do not match.");
+        std::get<I>(fDsp).process_oversampled(curr, next, count);
+        return process_from(next, curr, count, std::integral_constant<unsigned, I + 1>());
+    }
+
+    float **process_from(float **curr, float **, unsigned, std::integral_constant<unsigned, Size>) noexcept
+    {
+        return curr;
+    }
+
+private:
+    enum { MaxChannels = oversampled_chain_max(1, Dsp::NumInputs..., Dsp::NumOutputs...) };
+
+    Tuple fDsp;
+    float fBuffer[2][MaxChannels][Oversampling * MaximumFrames];
+};
+
+#endif // FAUSTPP_OVERSAMPLED_CHAIN_DEFINED
+{% endif %}
+{% endblock %}
@@ -0,0 +1,292 @@
+{% extends "generic.cpp" %}
+
+{#
+  The polyphonic template runs a pool of voices of an instrument, following
+  the conventions of Faust for the controls `freq`, `gain` and `gate`, which
+  are found by their symbol, or else their label. The voices are allocated on
+  the note events, and a voice goes to sleep when its output remains below
+  the threshold for a while after the release.
+#}
+{% set PolyThreshold = PolyThreshold|default(-80) %}
+{% set PolyControls = namespace(freq=none, gain=none, gate=none) %}
+{% for w in active %}
+{% set name = w.meta.symbol|default(w.label) %}
+{% if name == "freq" %}
+{% set PolyControls.freq = w.var %}
+{% elif name == "gain" %}
+{% set PolyControls.gain = w.var %}
+{% elif name == "gate" %}
+{% set PolyControls.gate = w.var %}
+{% endif %}
+{% endfor %}
+
+{% block ImplementationPrologue %}
+{{super()}}
+{% if PolyControls.gate is none %}
+{{fail("The polyphonic template requires a control named `gate`.")}}
+{% endif %}
+{% endblock %}
+
+{% block ImplementationIncludeExtra %}
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+{% endblock %}
+
+{% block ImplementationBeforeClassDefs %}
+//------------------------------------------------------------------------------
+// The voices
+//
+// The DSPs of the voices are contiguous, and so are the small states which
+// the allocation scans. The voices to process are listed at the front of an
+// array, so the processing does not visit the voices which are asleep.
+
+enum { PolyFrames = {{PolyFrames|default(256)}} };
+enum { PolyIdleFrames = {{PolyIdleFrames|default(1024)}} };
+static const float PolyThreshold = {{10 ** (PolyThreshold / 20.0)}};
+
+enum PolyVoiceState : uint8_t {
+    PolyFree,
+    PolyHeld,
+    PolyReleased,
+};
+
+struct {{Identifier}}::Voices : {{Identifier}}::BasicDsp {
+    unsigned allocate() noexcept;
+    void start(unsigned voice, unsigned key, float velocity) noexcept;
+    void release(unsigned voice) noexcept;
+
+    {{class_name}} dsp[NumVoices];
+    // the states of the voices
+    uint8_t state[NumVoices];
+    unsigned key[NumVoices];
+    uint32_t age[NumVoices];
+    uint32_t idle[NumVoices];
+    // the voices to process
+    unsigned active[NumVoices];
+    unsigned num_active = 0;
+    // the order of the notes, for the stealing
+    uint32_t clock = 0;
+    float buffer[{{[outputs, 1]|max}}][PolyFrames];
+};
+
+// choose a free voice, or else the oldest released voice, or else the oldest
+unsigned {{Identifier}}::Voices::allocate() noexcept
+{
+    unsigned best = 0;
+    for (unsigned voice = 0; voice < NumVoices; ++voice) {
+        if (state[voice] == PolyFree)
+            return voice;
+        bool released = state[voice] == PolyReleased;
+        bool best_released = state[best] == PolyReleased;
+        if (released > best_released ||
+            (released == best_released && clock - age[voice] > clock - age[best]))
+            best = voice;
+    }
+
+    // silence the stolen voice, its envelope restarts from zero
+    dsp[best].instanceClear();
+    for (unsigned i = 0; i < num_active; ++i) {
+        if (active[i] == best) {
+            active[i] = active[--num_active];
+            break;
+        }
+    }
+    state[best] = PolyFree;
+    return best;
+}
+
+void {{Identifier}}::Voices::start(unsigned voice, unsigned note, float velocity) noexcept
+{
+    {{class_name}} &voice_dsp = dsp[voice];
+    {% if PolyControls.freq is not none %}
+    voice_dsp.{{PolyControls.freq}} = 440.0f * std::pow(2.0f, ((float)note - 69.0f) / 12.0f);
+    {% endif %}
+    {% if PolyControls.gain is not none %}
+    voice_dsp.{{PolyControls.gain}} = velocity;
+    {% else %}
+    (void)velocity;
+    {% endif %}
+    voice_dsp.{{PolyControls.gate}} = 1;
+
+    if (state[voice] == PolyFree)
+        active[num_active++] = voice;
+    state[voice] = PolyHeld;
+    key[voice] = note;
+    age[voice] = clock++;
+    idle[voice] = 0;
+}
+
+void {{Identifier}}::Voices::release(unsigned voice) noexcept
+{
+    dsp[voice].{{PolyControls.gate}} = 0;
+    state[voice] = PolyReleased;
+    idle[voice] = 0;
+}
+{% endblock %}
+
+{% block ImplementationSetupDsp %}
+    Voices *voices = new Voices;
+    fDsp.reset(voices);
+    for (unsigned voice = 0; voice < NumVoices; ++voice) {
+        voices->dsp[voice].instanceResetUserInterface();
+        voices->state[voice] = PolyFree;
+        voices->key[voice] = 0;
+        voices->age[voice] = 0;
+        voices->idle[voice] = 0;
+    }
+{% endblock %}
+
+{% block ImplementationInitDsp %}
+    Voices &voices = static_cast<Voices &>(*fDsp);
+    {{class_name}}::classInit(sample_rate);
+    for (unsigned voice = 0; voice < NumVoices; ++voice)
+        voices.dsp[voice].instanceConstants(sample_rate);
+    clear();
+{% endblock %}
+
+{% block ImplementationClearDsp %}
+    Voices &voices = static_cast<Voices &>(*fDsp);
+    for (unsigned voice = 0; voice < NumVoices; ++voice) {
+        voices.dsp[voice].{{PolyControls.gate}} = 0;
+        voices.dsp[voice].instanceClear();
+        voices.state[voice] = PolyFree;
+    }
+    voices.num_active = 0;
+{% endblock %}
+
+{% block ImplementationProcessDsp %}
+    Voices &voices = static_cast<Voices &>(*fDsp);
+    const float *inputs[] = {
+        {% for i in range(inputs) %}in{{i}},{% endfor %}
+    };
+    float *outputs[] = {
+        {% for i in range(outputs) %}out{{i}},{% endfor %}
+    };
+    (void)inputs;
+
+    for (unsigned i = 0; i < {{outputs}}; ++i)
+        std::memset(outputs[i], 0, count * sizeof(float));
+
+    for (unsigned index = 0; index < count;) {
+        unsigned segment = count - index;
+        if (segment > PolyFrames)
+            segment = PolyFrames;
+
+        float *voice_inputs[] = {
+            {% for i in range(inputs) %}const_cast<float *>(inputs[{{i}}] + index),{% endfor %}
+        };
+        float *voice_outputs[] = {
+            {% for i in range(outputs) %}voices.buffer[{{i}}],{% endfor %}
+        };
+
+        for (unsigned i = 0; i < voices.num_active;) {
+            unsigned voice = voices.active[i];
+{% if Trace|default(0) %}
+            {
+                TraceScope trace("{{Identifier}}::compute", fTraceInstance, voice);
+                voices.dsp[voice].compute(segment, voice_inputs, voice_outputs);
+            }
+{% else %}
+            voices.dsp[voice].compute(segment, voice_inputs, voice_outputs);
+{% endif %}
+
+            float peak = 0;
+            for (unsigned c = 0; c < {{outputs}}; ++c) {
+                float *mix = outputs[c] + index;
+                const float *buffer = voices.buffer[c];
+                for (unsigned j = 0; j < segment; ++j) {
+                    mix[j] += buffer[j];
+                    peak = std::max(peak, std::fabs(buffer[j]));
+                }
+            }
+
+            // put to sleep the voices released and silent long enough
+            if (voices.state[voice] == PolyReleased) {
+                voices.idle[voice] = (peak < PolyThreshold) ? (voices.idle[voice] + segment) : 0;
+                if (voices.idle[voice] >= PolyIdleFrames) {
+                    voices.state[voice] = PolyFree;
+                    voices.active[i] = voices.active[--voices.num_active];
+                    continue;
+                }
+            }
+            ++i;
+        }
+
+        index += segment;
+    }
+{% endblock %}
+
+{% block ImplementationGetParameter %}
+    Voices &voices = static_cast<Voices &>(*fDsp);
+    switch (index) {
+    {% for w in active + passive %}
+    case {{loop.index0}}:
+        return voices.dsp[0].{{w.var}};
+    {% endfor %}
+    default:
+        (void)voices;
+        return 0;
+    }
+{% endblock %}
+
+{% block ImplementationSetParameter %}
+    Voices &voices = static_cast<Voices &>(*fDsp);
+    switch (index) {
+    {% for w in active %}
+    case {{loop.index0}}:
+        for (unsigned voice = 0; voice < NumVoices; ++voice)
+            voices.dsp[voice].{{w.var}} = value;
+        break;
+    {% endfor %}
+    default:
+        (void)voices;
+        (void)value;
+        break;
+    }
+{% endblock %}
+
+{% block ImplementationGetWidget %}
+    Voices &voices = static_cast<Voices &>(*fDsp);
+    return voices.dsp[0].{{w.var}};
+{% endblock %}
+
+{% block ImplementationSetWidget %}
+    Voices &voices = static_cast<Voices &>(*fDsp);
+    for (unsigned voice = 0; voice < NumVoices; ++voice)
+        voices.dsp[voice].{{w.var}} = value;
+{% endblock %}
+
+{% block ImplementationEpilogue %}
+void {{Identifier}}::note_on(unsigned key, float velocity) noexcept
+{
+    Voices &voices = static_cast<Voices &>(*fDsp);
+    note_off(key);
+    voices.start(voices.allocate(), key, velocity);
+}
+
+void {{Identifier}}::note_off(unsigned key) noexcept
+{
+    Voices &voices = static_cast<Voices &>(*fDsp);
+    for (unsigned voice = 0; voice < NumVoices; ++voice) {
+        if (voices.state[voice] == PolyHeld && voices.key[voice] == key)
+            voices.release(voice);
+    }
+}
+
+void {{Identifier}}::all_notes_off() noexcept
+{
+    Voices &voices = static_cast<Voices &>(*fDsp);
+    for (unsigned voice = 0; voice < NumVoices; ++voice) {
+        if (voices.state[voice] == PolyHeld)
+            voices.release(voice);
+    }
+}
+
+unsigned {{Identifier}}::active_voices() const noexcept
+{
+    Voices &voices = static_cast<Voices &>(*fDsp);
+    return voices.num_active;
+}
+{{super()}}
+{% endblock %}
@@ -0,0 +1,35 @@
+{% extends "generic.hpp" %}
+
+{% block ClassCapacityDecls %}
+{% set voices = PolyVoices|default(8) %}
+    // the estimates of the resources of the Faust code, for all the voices,
+    // except the tables which are shared, and per frame for the operations,
+    // when all the voices are playing
+    static constexpr std::size_t StateBytes = {{voices * capacity.state_bytes}};
+    static constexpr std::size_t DelayBytes = {{voices * capacity.delay_bytes}};
+    static constexpr std::size_t TableBytes = {{capacity.table_bytes}};
+    static constexpr std::size_t OpsPerSample = {{voices * capacity.ops_per_sample}};
+    static constexpr std::size_t CallsPerSample = {{voices * capacity.calls_per_sample}};
+
+{% endblock %}
+
+{% block ClassExtraDecls %}
+public:
+    enum { NumVoices = {{PolyVoices|default(8)}} };
+
+    // start a note on a free voice, or else on a stolen one, the velocity
+    // being the gain between 0 and 1
+    void note_on(unsigned key, float velocity) noexcept;
+
+    // release the voices which play the note
+    void note_off(unsigned key) noexcept;
+
+    // release all the voices
+    void all_notes_off() noexcept;
+
+    // the number of voices which are processed, the others being asleep
+    unsigned active_voices() const noexcept;
+
+private:
+    struct Voices;
+{% endblock %}
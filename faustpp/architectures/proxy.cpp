@@ -0,0 +1,295 @@
+{% extends "generic.cpp" %}
+
+{#
+  The proxy has the interface of the generic class, but the DSP runs in a
+  worker process, which is the `proxy_worker` architecture built with the
+  generic class of the same DSP. If the worker crashes or stops answering,
+  the proxy outputs silence, and the host remains running.
+#}
+
+{% set ProxyTimeout = ProxyTimeout|default(100) %}
+
+{% block ImplementationIncludeExtra %}
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char **environ;
+{% endblock %}
+
+{% block ImplementationFaustCode %}
+// the Faust code runs in the worker process
+{% endblock %}
+
+{% block ImplementationBeforeClassDefs %}
+{% include "proxy_protocol.inc" %}
+
+struct {{Identifier}}::Proxy {
+    ~Proxy() { stop(); }
+    bool start();
+    void stop();
+    bool call(uint32_t command, uint64_t timeout_ns) noexcept;
+    void push_event(uint32_t index, float value) noexcept;
+
+    ProxyShared *fShared = nullptr;
+    pid_t fPid = -1;
+    bool fConnected = false;
+    uint32_t fSequence = 0;
+    float fSampleRate = 0;
+    float fLatency = 0;
+    uint64_t fWorkerTime = 0;
+    // the last values of the parameters, and whether the worker needs all
+    // of them, after a restart or an overflow of the events
+    float fValues[{{[active|length + passive|length, 1]|max}}] = {};
+    std::atomic<bool> fResync{true};
+};
+
+static const uint64_t ProxyTimeoutNs = {{ProxyTimeout}} * UINT64_C(1000000);
+static const uint64_t ProxyStartTimeoutNs = 5 * UINT64_C(1000000000);
+
+bool {{Identifier}}::Proxy::start()
+{
+    int fd = memfd_create("faustpp-proxy", MFD_CLOEXEC);
+    if (fd == -1)
+        return false;
+
+    // the worker finds the shared memory as its descriptor 3
+    if (fd == 3) {
+        int other = fcntl(fd, F_DUPFD_CLOEXEC, 4);
+        close(fd);
+        if (other == -1)
+            return false;
+        fd = other;
+    }
+
+    void *memory = MAP_FAILED;
+    if (ftruncate(fd, sizeof(ProxyShared)) == 0)
+        memory = mmap(nullptr, sizeof(ProxyShared), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    mlock(memory, sizeof(ProxyShared));
+
+    ProxyShared *shared = new (memory) ProxyShared;
+    shared->magic = ProxyMagic;
+    shared->version = ProxyVersion;
+    shared->size = sizeof(ProxyShared);
+    fShared = shared;
+    fSequence = 0;
+    fResync.store(true);
+
+    const char *path = getenv("FAUSTPP_PROXY_WORKER");
+    if (!path || !path[0])
+        path = {{cstr(ProxyWorker|default(Identifier ~ "_worker"))}};
+    char *argv[] = { const_cast<char *>(path), const_cast<char *>("3"), nullptr };
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fd, 3);
+    int err = posix_spawnp(&fPid, path, &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fd);
+
+    if (err != 0) {
+        fPid = -1;
+        stop();
+        return false;
+    }
+
+    fConnected = true;
+    return call(ProxyAttach, ProxyStartTimeoutNs);
+}
+
+void {{Identifier}}::Proxy::stop()
+{
+    if (fPid != -1) {
+        if (!(fConnected && call(ProxyQuit, ProxyTimeoutNs)))
+            kill(fPid, SIGKILL);
+        while (waitpid(fPid, nullptr, 0) == -1 && errno == EINTR) {}
+        fPid = -1;
+    }
+    fConnected = false;
+
+    if (fShared) {
+        munmap(fShared, sizeof(ProxyShared));
+        fShared = nullptr;
+    }
+}
+
+bool {{Identifier}}::Proxy::call(uint32_t command, uint64_t timeout_ns) noexcept
+{
+    if (!fConnected)
+        return false;
+
+    ProxyShared *shared = fShared;
+    if (fResync.exchange(false)) {
+        for (unsigned i = 0; i < NumActives; ++i)
+            shared->parameters[i] = fValues[i];
+        shared->resync = 1;
+    }
+    shared->command = command;
+
+    uint32_t sequence = ++fSequence;
+    shared->request.store(sequence, std::memory_order_release);
+    proxy_futex_wake(shared->request);
+
+    // spin while the answer is quick, then sleep by slices of a millisecond
+    // at most, checking in between that the worker has not exited
+    uint32_t response;
+    uint64_t deadline = 0;
+    for (unsigned spins = 0; (response = shared->response.load(std::memory_order_acquire)) != sequence;) {
+        if (spins < ProxySpins) {
+            ++spins;
+            continue;
+        }
+        uint64_t now = proxy_monotonic_ns();
+        if (deadline == 0)
+            deadline = now + timeout_ns;
+        else if (waitpid(fPid, nullptr, WNOHANG) == fPid) {
+            fConnected = false;
+            fPid = -1;
+            return false;
+        }
+        else if (now >= deadline) {
+            fConnected = false;
+            kill(fPid, SIGKILL);
+            return false;
+        }
+        uint64_t slice = deadline - now;
+        proxy_futex_wait(shared->response, response, (long)((slice < 1000000) ? slice : 1000000));
+    }
+
+    // the passive parameters are the outputs of the worker
+    for (unsigned i = NumActives; i < NumParameters; ++i)
+        fValues[i] = shared->parameters[i];
+    return true;
+}
+
+void {{Identifier}}::Proxy::push_event(uint32_t index, float value) noexcept
+{
+    fValues[index] = value;
+    if (!fShared)
+        return;
+
+    ProxyShared *shared = fShared;
+    uint32_t write = shared->event_write.load(std::memory_order_relaxed);
+    uint32_t read = shared->event_read.load(std::memory_order_acquire);
+    if (write - read >= ProxyEventCapacity) {
+        fResync.store(true);
+        return;
+    }
+    shared->events[write % ProxyEventCapacity] = ProxyEvent{index, value};
+    shared->event_write.store(write + 1, std::memory_order_release);
+}
+
+bool {{Identifier}}::connected() const noexcept
+{
+    return fProxy->fConnected;
+}
+
+bool {{Identifier}}::restart()
+{
+    Proxy &proxy = *fProxy;
+    proxy.stop();
+    if (!proxy.start())
+        return false;
+    if (proxy.fSampleRate > 0)
+        init(proxy.fSampleRate);
+    return proxy.fConnected;
+}
+
+unsigned long long {{Identifier}}::worker_time() const noexcept
+{
+    return fProxy->fWorkerTime;
+}
+{% endblock %}
+
+{% block ImplementationSetupDsp %}
+    Proxy *proxy = new Proxy;
+    fProxy.reset(proxy);
+    for (unsigned i = 0; i < NumParameters; ++i)
+        proxy->fValues[i] = parameter_range(i)->init;
+    proxy->start();
+{% endblock %}
+
+{% block ImplementationInitDsp %}
+    Proxy &proxy = *fProxy;
+    proxy.fSampleRate = sample_rate;
+    if (proxy.fConnected) {
+        proxy.fShared->sample_rate = sample_rate;
+        if (proxy.call(ProxyInit, ProxyStartTimeoutNs))
+            proxy.fLatency = proxy.fShared->latency;
+    }
+{% endblock %}
+
+{% block ImplementationClearDsp %}
+    fProxy->call(ProxyClear, ProxyTimeoutNs);
+{% endblock %}
+
+{% block ImplementationProcessDsp %}
+    Proxy &proxy = *fProxy;
+
+    uint64_t worker_time = 0;
+    for (unsigned index = 0; index < count;) {
+        unsigned segment = count - index;
+        if (segment > ProxyFrames)
+            segment = ProxyFrames;
+        bool processed = false;
+        if (proxy.fConnected) {
+            ProxyShared *shared = proxy.fShared;
+            {% for i in range(inputs) %}
+            std::memcpy(shared->inputs[{{i}}], in{{i}} + index, segment * sizeof(float));
+            {% endfor %}
+            shared->frames = segment;
+            processed = proxy.call(ProxyProcess, ProxyTimeoutNs);
+            if (processed) {
+                {% for i in range(outputs) %}
+                std::memcpy(out{{i}} + index, shared->outputs[{{i}}], segment * sizeof(float));
+                {% endfor %}
+                worker_time += shared->process_ns;
+            }
+        }
+        if (!processed) {
+            {% for i in range(outputs) %}
+            std::memset(out{{i}} + index, 0, segment * sizeof(float));
+            {% endfor %}
+        }
+        index += segment;
+    }
+    proxy.fWorkerTime = worker_time;
+{% endblock %}
+
+{% block ImplementationLatency %}
+    return fProxy->fLatency;
+{% endblock %}
+
+{% block ImplementationGetParameter %}
+    return (index < NumParameters) ? fProxy->fValues[index] : 0;
+{% endblock %}
+
+{% block ImplementationSetParameter %}
+    if (index < NumActives)
+        fProxy->push_event(index, value);
+{% endblock %}
+
+{% block ImplementationGetWidget %}
+    return fProxy->fValues[{{loop.index0}}];
+{% endblock %}
+
+{% block ImplementationSetWidget %}
+    fProxy->push_event({{loop.index0}}, value);
+{% endblock %}
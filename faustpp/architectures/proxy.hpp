@@ -0,0 +1,18 @@
+{% extends "generic.hpp" %}
+
+{% block ClassExtraDecls %}
+public:
+    // whether the worker process is running, and answers in time
+    bool connected() const noexcept;
+
+    // replace a worker which has failed by a new one, with the same sample
+    // rate and parameters, not to be called concurrently with the processing
+    bool restart();
+
+    // the time spent by the worker in the last processing, in nanoseconds
+    unsigned long long worker_time() const noexcept;
+
+private:
+    struct Proxy;
+    std::unique_ptr<Proxy> fProxy;
+{% endblock %}
@@ -0,0 +1,111 @@
+#include "{{Identifier}}.hpp"
+
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <time.h>
+#include <unistd.h>
+
+// A benchmark of the proxy architecture, which measures the round trip of the
+// processing in the worker process. The overhead is the round trip, minus the
+// time which the worker spends in the DSP.
+
+static uint64_t monotonic_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static double percentile(std::vector<uint64_t> &values, double p)
+{
+    size_t index = (size_t)(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return 1e-3 * values[index];
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "Usage: proxy_bench [options]\n"
+            "  -r <rate>      sample rate (48000)\n"
+            "  -n <count>     number of blocks per size (10000)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned sample_rate = 48000;
+    unsigned iterations = 10000;
+
+    for (int c; (c = getopt(argc, argv, "r:n:h")) != -1;) {
+        switch (c) {
+        case 'r': sample_rate = (unsigned)atoi(optarg); break;
+        case 'n': iterations = (unsigned)atoi(optarg); break;
+        default: usage(); return 1;
+        }
+    }
+    if (sample_rate < 1 || iterations < 1) {
+        usage();
+        return 1;
+    }
+
+    {{Identifier}} dsp;
+    if (!dsp.connected()) {
+        fprintf(stderr, "Cannot start the worker process.\n");
+        return 1;
+    }
+    dsp.init(sample_rate);
+
+    const unsigned sizes[] = { 16, 64, 256, 1024 };
+    const unsigned max_size = 1024;
+    std::vector<float> input((size_t)({{inputs}}) * max_size, 0.0f);
+    std::vector<float> output((size_t)({{outputs}}) * max_size, 0.0f);
+    float *in = input.data();
+    float *out = output.data();
+    (void)in;
+    (void)out;
+
+    printf("%6s %12s %12s %12s %12s %12s %12s\n",
+           "frames", "trip mean", "trip p50", "trip p99", "trip max", "overhead p50", "overhead p99");
+
+    std::vector<uint64_t> trips(iterations);
+    std::vector<uint64_t> overheads(iterations);
+    for (unsigned size : sizes) {
+        // warm up the caches, and the scheduling of the worker
+        for (unsigned i = 0; i < 100; ++i)
+            dsp.process(
+                {% for i in range(inputs) %}in + {{i}} * max_size,{% endfor %}
+                {% for i in range(outputs) %}out + {{i}} * max_size,{% endfor %}
+                size);
+
+        uint64_t total = 0;
+        for (unsigned i = 0; i < iterations; ++i) {
+            uint64_t start = monotonic_ns();
+            dsp.process(
+                {% for i in range(inputs) %}in + {{i}} * max_size,{% endfor %}
+                {% for i in range(outputs) %}out + {{i}} * max_size,{% endfor %}
+                size);
+            uint64_t trip = monotonic_ns() - start;
+            uint64_t worker = dsp.worker_time();
+            trips[i] = trip;
+            overheads[i] = (trip > worker) ? (trip - worker) : 0;
+            total += trip;
+        }
+
+        if (!dsp.connected()) {
+            fprintf(stderr, "The worker process has failed.\n");
+            return 1;
+        }
+
+        uint64_t worst = *std::max_element(trips.begin(), trips.end());
+        printf("%6u %10.2fus %10.2fus %10.2fus %10.2fus %10.2fus %10.2fus\n",
+               size, 1e-3 * total / iterations, percentile(trips, 0.5), percentile(trips, 0.99),
+               1e-3 * worst, percentile(overheads, 0.5), percentile(overheads, 0.99));
+    }
+
+    return 0;
+}
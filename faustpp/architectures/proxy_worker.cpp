@@ -0,0 +1,139 @@
+#include "{{Identifier}}.hpp"
+
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <memory>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+// The worker process of the proxy architecture, which runs the DSP out of the
+// process of the host. The proxy starts this program, with the shared memory
+// as the descriptor given in argument.
+
+{% include "proxy_protocol.inc" %}
+
+static void apply_events({{Identifier}} &dsp, ProxyShared &shared)
+{
+    uint32_t read = shared.event_read.load(std::memory_order_relaxed);
+    uint32_t write = shared.event_write.load(std::memory_order_acquire);
+    for (; read != write; ++read) {
+        const ProxyEvent &event = shared.events[read % ProxyEventCapacity];
+        dsp.set_parameter(event.index, event.value);
+    }
+    shared.event_read.store(read, std::memory_order_release);
+
+    // the complete values come after the events, which are older
+    if (shared.resync) {
+        for (unsigned i = 0; i < {{Identifier}}::NumActives; ++i)
+            dsp.set_parameter(i, shared.parameters[i]);
+        shared.resync = 0;
+    }
+}
+
+static void run_command({{Identifier}} &dsp, ProxyShared &shared)
+{
+    switch (shared.command) {
+    case ProxyInit:
+        dsp.init(shared.sample_rate);
+        shared.latency = dsp.latency();
+        break;
+    case ProxyClear:
+        dsp.clear();
+        break;
+    case ProxyProcess: {
+        unsigned frames = shared.frames;
+        if (frames > ProxyFrames)
+            frames = ProxyFrames;
+        uint64_t start = proxy_monotonic_ns();
+        dsp.process(
+            {% for i in range(inputs) %}shared.inputs[{{i}}],{% endfor %}
+            {% for i in range(outputs) %}shared.outputs[{{i}}],{% endfor %}
+            frames);
+        shared.process_ns = proxy_monotonic_ns() - start;
+        break;
+    }
+    default:
+        break;
+    }
+
+    for (unsigned i = 0; i < {{Identifier}}::NumParameters; ++i)
+        shared.parameters[i] = dsp.get_parameter(i);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "This program is started by the proxy of {{Identifier}}.\n");
+        return 1;
+    }
+
+    // do not survive the host
+    pid_t parent = getppid();
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() != parent)
+        return 1;
+
+    int fd = atoi(argv[1]);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != sizeof(ProxyShared)) {
+        fprintf(stderr, "The shared memory is invalid.\n");
+        return 1;
+    }
+    void *memory = mmap(nullptr, sizeof(ProxyShared), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        fprintf(stderr, "Cannot map the shared memory.\n");
+        return 1;
+    }
+    mlock(memory, sizeof(ProxyShared));
+
+    ProxyShared &shared = *(ProxyShared *)memory;
+    if (shared.magic != ProxyMagic || shared.version != ProxyVersion || shared.size != sizeof(ProxyShared)) {
+        fprintf(stderr, "The shared memory does not match this worker.\n");
+        return 1;
+    }
+
+    // the host waits for the processing, so the worker is realtime if permitted
+    sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    param.sched_priority = {{ProxyPriority|default(70)}};
+    sched_setscheduler(0, SCHED_FIFO, &param);
+
+    std::unique_ptr<{{Identifier}}> dsp(new {{Identifier}});
+
+    uint32_t done = shared.response.load(std::memory_order_relaxed);
+    for (bool quit = false; !quit;) {
+        uint32_t request;
+        unsigned spins = 0;
+        while ((request = shared.request.load(std::memory_order_acquire)) == done) {
+            if (spins < ProxySpins)
+                ++spins;
+            else
+                proxy_futex_wait(shared.request, done, 1000000000L);
+        }
+
+        apply_events(*dsp, shared);
+        run_command(*dsp, shared);
+        quit = shared.command == ProxyQuit;
+
+        done = request;
+        shared.response.store(done, std::memory_order_release);
+        proxy_futex_wake(shared.response);
+    }
+
+    return 0;
+}
@@ -0,0 +1,487 @@
+// Python wants its header before the standard ones
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "{{Identifier}}.hpp"
+
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <cstring>
+
+// A Python extension module, named `{{Identifier}}`, whose type `Dsp` wraps the
+// class generated by `generic` or `oversampled`.
+//
+// The audio is any object with the buffer protocol, such as the arrays of
+// NumPy, of 32-bit floats. It is planar, with the shape (channels, frames), or
+// interleaved, with the shape (frames, channels), and a single channel may be
+// a 1-D array. The contiguous channels are processed in place, without copy;
+// the others, such as the interleaved ones, are copied by small blocks.
+//
+// The processing releases the GIL, so that the instances in multiple Python
+// threads run in parallel. An instance is used by a single thread at a time.
+
+enum { BlockFrames = 1024 };
+
+struct DspObject {
+    PyObject_HEAD
+    {{Identifier}} *dsp;
+    float sample_rate;
+    // the copies of the channels which are not contiguous
+    float *scratch;
+    std::atomic<bool> busy;
+};
+
+//------------------------------------------------------------------------------
+// The audio buffers
+
+struct AudioBuffer {
+    AudioBuffer() { std::memset(&view, 0, sizeof(view)); }
+    ~AudioBuffer() { if (view.obj) PyBuffer_Release(&view); }
+    AudioBuffer(const AudioBuffer &) = delete;
+    AudioBuffer &operator=(const AudioBuffer &) = delete;
+
+    bool acquire(PyObject *object, unsigned channels, bool interleaved, bool writable, const char *what);
+    // the channel `c`, from the frame `index`, or null if not contiguous
+    float *contiguous(unsigned c, Py_ssize_t index) const;
+    void gather(unsigned c, Py_ssize_t index, float *dst, Py_ssize_t frames) const;
+    void scatter(unsigned c, Py_ssize_t index, const float *src, Py_ssize_t frames) const;
+
+    Py_buffer view;
+    Py_ssize_t frames = 0;
+    Py_ssize_t channel_stride = 0;
+    Py_ssize_t frame_stride = 0;
+};
+
+static bool is_float32_format(const char *format)
+{
+    if (!format)
+        return true;
+    if (format[0] == '=' || format[0] == '@' || (PY_LITTLE_ENDIAN && format[0] == '<') ||
+        (!PY_LITTLE_ENDIAN && format[0] == '>'))
+        ++format;
+    return !std::strcmp(format, "f");
+}
+
+bool AudioBuffer::acquire(PyObject *object, unsigned channels, bool interleaved, bool writable, const char *what)
+{
+    if (PyObject_GetBuffer(object, &view, writable ? PyBUF_RECORDS : PyBUF_RECORDS_RO) != 0)
+        return false;
+
+    if (view.itemsize != 4 || !is_float32_format(view.format)) {
+        PyErr_Format(PyExc_TypeError, "The %s are not 32-bit floats.", what);
+        return false;
+    }
+
+    if (view.ndim == 1 && channels == 1) {
+        frames = view.shape[0];
+        frame_stride = view.strides[0];
+    }
+    else if (view.ndim == 2 && !interleaved && view.shape[0] == channels) {
+        frames = view.shape[1];
+        channel_stride = view.strides[0];
+        frame_stride = view.strides[1];
+    }
+    else if (view.ndim == 2 && interleaved && view.shape[1] == channels) {
+        frames = view.shape[0];
+        channel_stride = view.strides[1];
+        frame_stride = view.strides[0];
+    }
+    else {
+        PyErr_Format(PyExc_ValueError, "The %s do not have the shape of %u %s channels.",
+                     what, channels, interleaved ? "interleaved" : "planar");
+        return false;
+    }
+
+    return true;
+}
+
+float *AudioBuffer::contiguous(unsigned c, Py_ssize_t index) const
+{
+    if (frame_stride != sizeof(float))
+        return nullptr;
+    return (float *)((char *)view.buf + c * channel_stride + index * frame_stride);
+}
+
+void AudioBuffer::gather(unsigned c, Py_ssize_t index, float *dst, Py_ssize_t frames) const
+{
+    const char *src = (const char *)view.buf + c * channel_stride + index * frame_stride;
+    for (Py_ssize_t i = 0; i < frames; ++i, src += frame_stride)
+        std::memcpy(&dst[i], src, sizeof(float));
+}
+
+void AudioBuffer::scatter(unsigned c, Py_ssize_t index, const float *src, Py_ssize_t frames) const
+{
+    char *dst = (char *)view.buf + c * channel_stride + index * frame_stride;
+    for (Py_ssize_t i = 0; i < frames; ++i, dst += frame_stride)
+        std::memcpy(dst, &src[i], sizeof(float));
+}
+
+// a new array of NumPy for the outputs
+static PyObject *new_output_array(Py_ssize_t frames, bool interleaved, bool flat)
+{
+    PyObject *numpy = PyImport_ImportModule("numpy");
+    if (!numpy)
+        return nullptr;
+    PyObject *array;
+    if (flat)
+        array = PyObject_CallMethod(numpy, "empty", "(n)s", frames, "float32");
+    else if (interleaved)
+        array = PyObject_CallMethod(numpy, "empty", "(nn)s", frames, (Py_ssize_t){{outputs}}, "float32");
+    else
+        array = PyObject_CallMethod(numpy, "empty", "(nn)s", (Py_ssize_t){{outputs}}, frames, "float32");
+    Py_DECREF(numpy);
+    return array;
+}
+
+//------------------------------------------------------------------------------
+// The type `Dsp`
+
+static PyObject *Dsp_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static const char *keywords[] = { "sample_rate", nullptr };
+    float sample_rate;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "f", const_cast<char **>(keywords), &sample_rate))
+        return nullptr;
+    if (!(sample_rate > 0)) {
+        PyErr_SetString(PyExc_ValueError, "The sample rate is not positive.");
+        return nullptr;
+    }
+
+    DspObject *self = (DspObject *)type->tp_alloc(type, 0);
+    if (!self)
+        return nullptr;
+    new (&self->busy) std::atomic<bool>(false);
+
+    // the instance may be large, and the scratch should not fail in process()
+    self->dsp = new (std::nothrow) {{Identifier}};
+    self->scratch = new (std::nothrow) float[({{inputs}} + {{outputs}}) * BlockFrames];
+    if (!self->dsp || !self->scratch) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    self->dsp->init(sample_rate);
+    self->sample_rate = sample_rate;
+
+    return (PyObject *)self;
+}
+
+static void Dsp_dealloc(DspObject *self)
+{
+    delete self->dsp;
+    delete[] self->scratch;
+    PyTypeObject *type = Py_TYPE(self);
+    type->tp_free((PyObject *)self);
+    Py_DECREF(type);
+}
+
+// marks the instance as used by the current thread, until the destruction
+struct DspGuard {
+    explicit DspGuard(DspObject *self_)
+        : self(self_), acquired(!self_->busy.exchange(true, std::memory_order_acquire))
+    {
+        if (!acquired)
+            PyErr_SetString(PyExc_RuntimeError, "The DSP is in use by another thread.");
+    }
+    ~DspGuard()
+    {
+        if (acquired)
+            self->busy.store(false, std::memory_order_release);
+    }
+    DspObject *self;
+    bool acquired;
+};
+
+static bool parameter_index(PyObject *key, unsigned &index)
+{
+    if (PyUnicode_Check(key)) {
+        const char *symbol = PyUnicode_AsUTF8(key);
+        if (!symbol)
+            return false;
+        for (unsigned i = 0; i < {{Identifier}}::NumParameters; ++i) {
+            if (!std::strcmp(symbol, {{Identifier}}::parameter_symbol(i))) {
+                index = i;
+                return true;
+            }
+        }
+        PyErr_Format(PyExc_KeyError, "There is no parameter `%s`.", symbol);
+        return false;
+    }
+
+    long value = PyLong_AsLong(key);
+    if (value == -1 && PyErr_Occurred())
+        return false;
+    if (value < 0 || value >= {{Identifier}}::NumParameters) {
+        PyErr_Format(PyExc_IndexError, "There is no parameter %ld.", value);
+        return false;
+    }
+    index = (unsigned)value;
+    return true;
+}
+
+static PyObject *Dsp_process(DspObject *self, PyObject *args, PyObject *kwds)
+{
+    static const char *keywords[] = { "inputs", "outputs", "interleaved", nullptr };
+    PyObject *input_object;
+    PyObject *output_object = Py_None;
+    int interleaved = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O$p", const_cast<char **>(keywords),
+                                     &input_object, &output_object, &interleaved))
+        return nullptr;
+
+    AudioBuffer input;
+    Py_ssize_t frames;
+    bool flat = false;
+    if ({{inputs}} == 0 && PyLong_Check(input_object)) {
+        // without inputs, the argument is the number of frames
+        frames = PyLong_AsSsize_t(input_object);
+        if (frames == -1 && PyErr_Occurred())
+            return nullptr;
+        if (frames < 0) {
+            PyErr_SetString(PyExc_ValueError, "The number of frames is negative.");
+            return nullptr;
+        }
+    }
+    else {
+        if (!input.acquire(input_object, {{inputs}}, interleaved, false, "inputs"))
+            return nullptr;
+        frames = input.frames;
+        flat = input.view.ndim == 1;
+    }
+
+    PyObject *result;
+    if (output_object == Py_None)
+        result = new_output_array(frames, interleaved, flat && {{outputs}} == 1);
+    else {
+        result = output_object;
+        Py_INCREF(result);
+    }
+    if (!result)
+        return nullptr;
+
+    AudioBuffer output;
+    if (!output.acquire(result, {{outputs}}, interleaved, true, "outputs")) {
+        Py_DECREF(result);
+        return nullptr;
+    }
+    if (output.frames != frames) {
+        PyErr_SetString(PyExc_ValueError, "The inputs and the outputs do not have the same number of frames.");
+        Py_DECREF(result);
+        return nullptr;
+    }
+
+    DspGuard guard(self);
+    if (!guard.acquired) {
+        Py_DECREF(result);
+        return nullptr;
+    }
+
+    {{Identifier}} &dsp = *self->dsp;
+    float *scratch = self->scratch;
+    (void)scratch;
+
+    Py_BEGIN_ALLOW_THREADS
+    for (Py_ssize_t index = 0; index < frames;) {
+        const unsigned count = (unsigned)std::min<Py_ssize_t>(BlockFrames, frames - index);
+
+        const float *in[{{[inputs, 1]|max}}];
+        float *out[{{[outputs, 1]|max}}];
+        {% if inputs > 0 %}
+        for (unsigned c = 0; c < {{inputs}}; ++c) {
+            in[c] = input.contiguous(c, index);
+            if (!in[c]) {
+                float *copy = scratch + c * BlockFrames;
+                input.gather(c, index, copy, count);
+                in[c] = copy;
+            }
+        }
+        {% endif %}
+        for (unsigned c = 0; c < {{outputs}}; ++c) {
+            out[c] = output.contiguous(c, index);
+            if (!out[c])
+                out[c] = scratch + ({{inputs}} + c) * BlockFrames;
+        }
+        (void)in;
+
+        dsp.process(
+            {% for i in range(inputs) %}in[{{i}}],{% endfor %}
+            {% for i in range(outputs) %}out[{{i}}],{% endfor %}
+            count);
+
+        for (unsigned c = 0; c < {{outputs}}; ++c) {
+            if (!output.contiguous(c, index))
+                output.scatter(c, index, out[c], count);
+        }
+
+        index += count;
+    }
+    Py_END_ALLOW_THREADS
+
+    return result;
+}
+
+static PyObject *Dsp_clear(DspObject *self, PyObject *)
+{
+    DspGuard guard(self);
+    if (!guard.acquired)
+        return nullptr;
+    self->dsp->clear();
+    Py_RETURN_NONE;
+}
+
+static PyObject *Dsp_get_parameter(DspObject *self, PyObject *key)
+{
+    unsigned index;
+    if (!parameter_index(key, index))
+        return nullptr;
+    return PyFloat_FromDouble(self->dsp->get_parameter(index));
+}
+
+static PyObject *Dsp_set_parameter(DspObject *self, PyObject *args)
+{
+    PyObject *key;
+    float value;
+    unsigned index;
+    if (!PyArg_ParseTuple(args, "Of", &key, &value) || !parameter_index(key, index))
+        return nullptr;
+    if (index >= {{Identifier}}::NumActives) {
+        PyErr_Format(PyExc_ValueError, "The parameter `%s` is an output.", {{Identifier}}::parameter_symbol(index));
+        return nullptr;
+    }
+    DspGuard guard(self);
+    if (!guard.acquired)
+        return nullptr;
+    self->dsp->set_parameter(index, value);
+    Py_RETURN_NONE;
+}
+
+static PyObject *Dsp_get_latency(DspObject *self, void *)
+{
+    return PyFloat_FromDouble(self->dsp->latency());
+}
+
+static PyObject *Dsp_get_sample_rate(DspObject *self, void *)
+{
+    return PyFloat_FromDouble(self->sample_rate);
+}
+
+static PyMethodDef Dsp_methods[] = {
+    { "process", (PyCFunction)(void (*)(void))Dsp_process, METH_VARARGS|METH_KEYWORDS,
+      "process(inputs, outputs=None, *, interleaved=False)\n"
+      "Process the inputs into the outputs, which are allocated if not given, and return the outputs." },
+    { "clear", (PyCFunction)(void (*)(void))Dsp_clear, METH_NOARGS,
+      "clear()\nClear the state of the DSP." },
+    { "get_parameter", (PyCFunction)(void (*)(void))Dsp_get_parameter, METH_O,
+      "get_parameter(key)\nGet the parameter of the given index or symbol." },
+    { "set_parameter", (PyCFunction)(void (*)(void))Dsp_set_parameter, METH_VARARGS,
+      "set_parameter(key, value)\nSet the parameter of the given index or symbol." },
+    { nullptr, nullptr, 0, nullptr },
+};
+
+static PyGetSetDef Dsp_getset[] = {
+    { const_cast<char *>("latency"), (getter)Dsp_get_latency, nullptr,
+      const_cast<char *>("The latency of the DSP, in frames."), nullptr },
+    { const_cast<char *>("sample_rate"), (getter)Dsp_get_sample_rate, nullptr,
+      const_cast<char *>("The sample rate of the DSP."), nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr },
+};
+
+static PyType_Slot Dsp_slots[] = {
+    { Py_tp_new, (void *)Dsp_new },
+    { Py_tp_dealloc, (void *)Dsp_dealloc },
+    { Py_tp_methods, (void *)Dsp_methods },
+    { Py_tp_getset, (void *)Dsp_getset },
+    { Py_tp_doc, (void *)"Dsp(sample_rate)\nAn instance of {{Identifier}}." },
+    { 0, nullptr },
+};
+
+static PyType_Spec Dsp_spec = {
+    "{{Identifier}}.Dsp",
+    sizeof(DspObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    Dsp_slots,
+};
+
+//------------------------------------------------------------------------------
+// The module
+
+// the description of a parameter, as a dictionary
+static PyObject *parameter_info(unsigned index)
+{
+    const {{Identifier}}::ParameterRange *range = {{Identifier}}::parameter_range(index);
+    return Py_BuildValue(
+        "{s:I,s:s,s:s,s:s,s:s,s:f,s:f,s:f,s:O,s:O,s:O,s:O,s:O}",
+        "index", index,
+        "label", {{Identifier}}::parameter_label(index),
+        "short_label", {{Identifier}}::parameter_short_label(index),
+        "symbol", {{Identifier}}::parameter_symbol(index),
+        "unit", {{Identifier}}::parameter_unit(index),
+        "init", range->init,
+        "min", range->min,
+        "max", range->max,
+        "output", (index >= {{Identifier}}::NumActives) ? Py_True : Py_False,
+        "trigger", {{Identifier}}::parameter_is_trigger(index) ? Py_True : Py_False,
+        "boolean", {{Identifier}}::parameter_is_boolean(index) ? Py_True : Py_False,
+        "integer", {{Identifier}}::parameter_is_integer(index) ? Py_True : Py_False,
+        "logarithmic", {{Identifier}}::parameter_is_logarithmic(index) ? Py_True : Py_False);
+}
+
+static int module_exec(PyObject *module)
+{
+    PyObject *type = PyType_FromSpec(&Dsp_spec);
+    if (!type || PyModule_AddObject(module, "Dsp", type) != 0) {
+        Py_XDECREF(type);
+        return -1;
+    }
+
+    PyObject *parameters = PyTuple_New({{Identifier}}::NumParameters);
+    if (!parameters)
+        return -1;
+    for (unsigned i = 0; i < {{Identifier}}::NumParameters; ++i) {
+        PyObject *info = parameter_info(i);
+        if (!info) {
+            Py_DECREF(parameters);
+            return -1;
+        }
+        PyTuple_SET_ITEM(parameters, i, info);
+    }
+    if (PyModule_AddObject(module, "parameters", parameters) != 0) {
+        Py_DECREF(parameters);
+        return -1;
+    }
+
+    if (PyModule_AddIntConstant(module, "num_inputs", {{Identifier}}::NumInputs) != 0 ||
+        PyModule_AddIntConstant(module, "num_outputs", {{Identifier}}::NumOutputs) != 0 ||
+        PyModule_AddStringConstant(module, "name", {{cstr(name)}}) != 0 ||
+        PyModule_AddStringConstant(module, "author", {{cstr(author)}}) != 0 ||
+        PyModule_AddStringConstant(module, "license", {{cstr(license)}}) != 0 ||
+        PyModule_AddStringConstant(module, "version", {{cstr(version)}}) != 0)
+        return -1;
+
+    return 0;
+}
+
+static PyModuleDef_Slot module_slots[] = {
+    { Py_mod_exec, (void *)module_exec },
+    { 0, nullptr },
+};
+
+static PyModuleDef module_def = {
+    PyModuleDef_HEAD_INIT,
+    "{{Identifier}}",
+    {{cstr(name)}},
+    0,
+    nullptr,
+    module_slots,
+    nullptr,
+    nullptr,
+    nullptr,
+};
+
+PyMODINIT_FUNC PyInit_{{Identifier}}()
+{
+    return PyModuleDef_Init(&module_def);
+}
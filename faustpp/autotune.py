@@ -0,0 +1,235 @@
+#          Copyright Jean Pierre Cimalando 2022.
+# Distributed under the Boost Software License, Version 1.0.
+#    (See accompanying file LICENSE or copy at
+#          http://www.boost.org/LICENSE_1_0.txt)
+#
+# SPDX-License-Identifier: BSL-1.0
+
+from faustpp.metadata import Metadata
+from faustpp.render import render_metadata
+from typing import Any, Optional, List, Dict, Tuple
+from subprocess import run, CompletedProcess, PIPE, STDOUT
+from tempfile import TemporaryDirectory, mkdtemp
+from concurrent.futures import ThreadPoolExecutor
+import faustpp.main
+import threading
+import json
+import shlex
+import os
+import sys
+
+# The search of the arguments of the faust compiler which make the fastest code
+# for a given DSP.
+#
+# Each variant is generated with the templates `generic` and `bench`, compiled
+# with the host compiler, and timed. The search varies one option at a time
+# from the best variant, and moves to the best of these, until none of them is
+# faster. The variants are generated and compiled in parallel, and timed one
+# after the other, so that they do not disturb the measures of each other.
+
+class TuneOptions:
+    outfile: Optional[str] = None
+    jobs: int = 1
+    cxx: str = 'c++'
+    cxxflags: str = '-O3'
+    block: int = 256
+    duration: float = 2.0
+    repeat: int = 3
+
+class TuneError(Exception):
+    pass
+
+# the options, and their values, the first being the default of faust
+TUNE_AXES: List[Tuple[str, List[Any]]] = [
+    ('vec', [False, True]),
+    ('vs', [32, 8, 16, 64, 128, 256]),
+    ('lv', [0, 1]),
+    ('dfs', [False, True]),
+    ('mcd', [16, 4, 8, 32, 64]),
+    ('dlt', [None, 64, 1024]),
+]
+
+# the options which only matter in the vector mode
+VECTOR_AXES = ('vs', 'lv', 'dfs')
+
+# the gain below which a variant is not considered faster, as it is noise
+MIN_GAIN: float = 0.01
+
+MAX_ROUNDS: int = 4
+
+Variant = Tuple[Tuple[str, Any], ...]
+
+def default_variant() -> Variant:
+    return tuple((name, values[0]) for name, values in TUNE_AXES)
+
+def variant_flags(variant: Variant) -> List[str]:
+    config: Dict[str, Any] = dict(variant)
+    flags: List[str] = []
+    if config['vec']:
+        flags.append('-vec')
+        if config['vs'] != 32:
+            flags += ['-vs', str(config['vs'])]
+        if config['lv'] != 0:
+            flags += ['-lv', str(config['lv'])]
+        if config['dfs']:
+            flags.append('-dfs')
+    if config['mcd'] != 16:
+        flags += ['-mcd', str(config['mcd'])]
+    if config['dlt'] is not None:
+        flags += ['-dlt', str(config['dlt'])]
+    return flags
+
+def neighbor_variants(variant: Variant) -> List[Variant]:
+    config: Dict[str, Any] = dict(variant)
+    result: List[Variant] = []
+    for name, values in TUNE_AXES:
+        if name in VECTOR_AXES and not config['vec']:
+            continue
+        for value in values:
+            if value != config[name]:
+                result.append(tuple((n, value if n == name else v) for n, v in variant))
+    return result
+
+class Tuner:
+    dspfile: str
+    faustargs: List[str]
+    options: TuneOptions
+    workdir: str
+    # the time per sample of the variants, by their flags, or None if failed
+    results: Dict[Tuple[str, ...], Optional[float]]
+    bench_lock: threading.Lock
+
+    def __init__(self, dspfile: str, faustargs: List[str], options: TuneOptions, workdir: str):
+        self.dspfile = dspfile
+        self.faustargs = faustargs
+        self.options = options
+        self.workdir = workdir
+        self.results = {}
+        self.bench_lock = threading.Lock()
+
+    def evaluate(self, variants: List[Variant]):
+        todo: List[Variant] = []
+        for variant in variants:
+            key = tuple(variant_flags(variant))
+            if key not in self.results and variant not in todo:
+                todo.append(variant)
+        with ThreadPoolExecutor(max_workers=self.options.jobs) as pool:
+            for variant, time in zip(todo, pool.map(self.measure, todo)):
+                self.results[tuple(variant_flags(variant))] = time
+
+    def time_of(self, variant: Variant) -> Optional[float]:
+        return self.results.get(tuple(variant_flags(variant)))
+
+    def measure(self, variant: Variant) -> Optional[float]:
+        flags: List[str] = variant_flags(variant)
+        builddir: str = mkdtemp(prefix='variant', dir=self.workdir)
+
+        try:
+            executable: str = self.build(flags, builddir)
+        except Exception as ex:
+            sys.stderr.write('%s: failed, %s\n' % (' '.join(flags) or '(default)', str(ex).strip()))
+            return None
+
+        # the benchmarks run alone, so they do not compete for the processor
+        with self.bench_lock:
+            best: Optional[float] = None
+            for _ in range(self.options.repeat):
+                time: Optional[float] = self.bench(executable)
+                if time is not None and (best is None or time < best):
+                    best = time
+
+        if best is None:
+            sys.stderr.write('%s: the benchmark failed\n' % (' '.join(flags) or '(default)'))
+        else:
+            sys.stderr.write('%s: %.3f ns/sample\n' % (' '.join(flags) or '(default)', best))
+        return best
+
+    def build(self, flags: List[str], builddir: str) -> str:
+        md: Metadata = faustpp.main.compile_metadata(self.dspfile, self.faustargs + flags)
+        defines: Dict[str, str] = {'Identifier': 'autotune_dsp'}
+        archdir: str = os.path.join(os.path.dirname(__file__), 'architectures')
+        for tmplname, outname in (('generic.hpp', 'autotune_dsp.hpp'),
+                                  ('generic.cpp', 'autotune_dsp.cpp'),
+                                  ('bench.cpp', 'bench.cpp')):
+            with open(os.path.join(builddir, outname), 'w') as out:
+                render_metadata(out, md, os.path.join(archdir, tmplname), defines)
+
+        executable: str = os.path.join(builddir, 'bench')
+        cmd: List[str] = [self.options.cxx] + shlex.split(self.options.cxxflags) + [
+            '-I', builddir,
+            os.path.join(builddir, 'autotune_dsp.cpp'),
+            os.path.join(builddir, 'bench.cpp'),
+            '-o', executable]
+        proc: CompletedProcess = run(cmd, stdout=PIPE, stderr=STDOUT)
+        if proc.returncode != 0:
+            raise TuneError(proc.stdout.decode('utf-8', errors='replace'))
+        return executable
+
+    def bench(self, executable: str) -> Optional[float]:
+        cmd: List[str] = [executable, '-C', '-m', 'static',
+                          '-b', str(self.options.block), '-d', str(self.options.duration)]
+        proc: CompletedProcess = run(cmd, stdout=PIPE)
+        if proc.returncode != 0:
+            return None
+        # the columns are dsp, oversampling, block, mode, ns_per_sample...
+        lines: List[str] = proc.stdout.decode('utf-8').splitlines()
+        if len(lines) < 2:
+            return None
+        return float(lines[1].split(',')[4])
+
+def autotune(dspfile: str, faustargs: List[str], options: TuneOptions):
+    with TemporaryDirectory(prefix='faustpp-autotune-') as workdir:
+        tuner = Tuner(dspfile, faustargs, options, workdir)
+
+        best: Variant = default_variant()
+        tuner.evaluate([best])
+        baseline: Optional[float] = tuner.time_of(best)
+        if baseline is None:
+            raise TuneError('The DSP does not build with the default arguments.\n')
+        best_time: float = baseline
+
+        for _ in range(MAX_ROUNDS):
+            candidates: List[Variant] = neighbor_variants(best)
+            tuner.evaluate(candidates)
+            improved: bool = False
+            for variant in candidates:
+                time: Optional[float] = tuner.time_of(variant)
+                if time is not None and time < best_time * (1 - MIN_GAIN):
+                    best, best_time, improved = variant, time, True
+            if not improved:
+                break
+
+    flags: List[str] = variant_flags(best)
+    sys.stderr.write('The best arguments are %s, %.3f ns/sample, %.2fx the default.\n' % (
+        ' '.join(flags) or 'the defaults', best_time, baseline / best_time))
+
+    variants: List[Dict[str, Any]] = []
+    for key, time in sorted(tuner.results.items(), key=lambda item: (item[1] is None, item[1] or 0)):
+        variants.append({'faustargs': list(key), 'ns_per_sample': time})
+
+    config: Dict[str, Any] = {
+        'dsp': os.path.basename(dspfile),
+        'faustargs': flags,
+        'ns_per_sample': best_time,
+        'default_ns_per_sample': baseline,
+        'fixed_faustargs': faustargs,
+        'cxx': options.cxx,
+        'cxxflags': options.cxxflags,
+        'block': options.block,
+        'variants': variants,
+    }
+
+    text: str = json.dumps(config, indent=2) + '\n'
+    if options.outfile is None:
+        sys.stdout.write(text)
+    else:
+        with open(options.outfile, 'w') as out:
+            out.write(text)
+
+def load_flags(path: str) -> List[str]:
+    with open(path, 'r') as file:
+        config: Dict[str, Any] = json.load(file)
+    flags: Any = config.get('faustargs')
+    if not isinstance(flags, list) or not all(isinstance(flag, str) for flag in flags):
+        raise TuneError('The file of arguments is invalid.\n')
+    return flags
@@ -0,0 +1,155 @@
+#          Copyright Jean Pierre Cimalando 2022.
+# Distributed under the Boost Software License, Version 1.0.
+#    (See accompanying file LICENSE or copy at
+#          http://www.boost.org/LICENSE_1_0.txt)
+#
+# SPDX-License-Identifier: BSL-1.0
+
+from faustpp.metadata import Metadata
+from faustpp.render import render_metadata
+from faustpp.capacity import capacity_report
+from typing import Any, Optional, List, Dict
+from concurrent.futures import ProcessPoolExecutor
+import faustpp.main
+import faustpp.autotune
+import faustpp.cache
+import traceback
+import json
+import io
+import os
+import sys
+
+# The generation of many files in a single invocation, from a manifest.
+#
+# Each job of the manifest is a DSP, compiled once by faust, and rendered with
+# all of its templates. The jobs run in a pool of processes, and each process
+# keeps its environments of the templates, so that these are compiled once.
+#
+# A file is written only if its contents change, so that the build systems do
+# not rebuild what depends on it.
+
+class BatchError(Exception):
+    pass
+
+class BatchOutput:
+    template: str
+    output: str
+    defines: Dict[str, str]
+
+class BatchJob:
+    dspfile: str
+    faustargs: List[str]
+    defines: Dict[str, str]
+    outputs: List[BatchOutput]
+    reportfile: Optional[str]
+
+def string_define(key: str, value: Any, where: str) -> str:
+    # the defines are strings, as given by `-D` on the command line, and the
+    # booleans are written as the numbers which the templates test
+    if isinstance(value, bool):
+        return '1' if value else '0'
+    if isinstance(value, (str, int, float)):
+        return str(value)
+    raise BatchError('The define %s of %s is not a string, a number or a boolean.\n' % (key, where))
+
+def string_defines(value: Any, where: str) -> Dict[str, str]:
+    if value is None:
+        return {}
+    if not isinstance(value, dict):
+        raise BatchError('The defines of %s are not an object.\n' % where)
+    return {str(k): string_define(str(k), v, where) for k, v in value.items()}
+
+def load_manifest(path: str, faustargs: List[str], defines: Dict[str, str]) -> List[BatchJob]:
+    # the paths are relative to the manifest
+    basedir: str = os.path.dirname(os.path.abspath(path))
+    def resolve(name: str) -> str:
+        return os.path.join(basedir, name)
+
+    with open(path, 'r') as file:
+        manifest: Any = json.load(file)
+    entries: Any = manifest.get('jobs') if isinstance(manifest, dict) else manifest
+    if not isinstance(entries, list):
+        raise BatchError('The manifest has no list of jobs.\n')
+
+    jobs: List[BatchJob] = []
+    for index, entry in enumerate(entries):
+        where: str = 'the job %d' % index
+        if not isinstance(entry, dict) or not isinstance(entry.get('dsp'), str):
+            raise BatchError('The DSP of %s is missing.\n' % where)
+
+        job = BatchJob()
+        job.dspfile = resolve(entry['dsp'])
+        job.faustargs = list(faustargs)
+        if entry.get('flagsfile') is not None:
+            job.faustargs += faustpp.autotune.load_flags(resolve(entry['flagsfile']))
+        job.faustargs += [str(arg) for arg in entry.get('faustargs', [])]
+        job.defines = dict(defines)
+        job.defines.update(string_defines(entry.get('defines'), where))
+        job.reportfile = resolve(entry['report']) if entry.get('report') is not None else None
+
+        job.outputs = []
+        for output in entry.get('outputs', []):
+            if not isinstance(output, dict) or not isinstance(output.get('template'), str) or \
+               not isinstance(output.get('output'), str):
+                raise BatchError('An output of %s lacks its template or its file.\n' % where)
+            out = BatchOutput()
+            # the template is a path, or the name of one of the package
+            template: str = resolve(output['template'])
+            out.template = template if os.path.isfile(template) else \
+                faustpp.main.find_template_file(output['template'])
+            out.output = resolve(output['output'])
+            out.defines = string_defines(output.get('defines'), where)
+            job.outputs.append(out)
+
+        jobs.append(job)
+
+    return jobs
+
+def write_if_changed(path: str, text: str):
+    try:
+        with open(path, 'r') as file:
+            if file.read() == text:
+                return
+    except OSError:
+        pass
+    temp: str = path + '.tmp%d' % os.getpid()
+    with open(temp, 'w') as file:
+        file.write(text)
+    os.replace(temp, path)
+
+def init_worker(cachedir: Optional[str]):
+    # the processes may be spawned, rather than forked with the settings
+    faustpp.cache.set_cache_dir(cachedir)
+
+def run_job(job: BatchJob) -> Optional[str]:
+    # the error message, or None on success
+    try:
+        md: Metadata = faustpp.main.compile_metadata(job.dspfile, job.faustargs)
+
+        if job.reportfile is not None:
+            write_if_changed(job.reportfile, json.dumps(capacity_report(md), indent=2) + '\n')
+
+        for output in job.outputs:
+            defines: Dict[str, str] = dict(job.defines)
+            defines.update(output.defines)
+            out = io.StringIO()
+            render_metadata(out, md, output.template, defines)
+            write_if_changed(output.output, out.getvalue())
+    except Exception as ex:
+        return '%s: %s' % (job.dspfile, ''.join(traceback.format_exception_only(type(ex), ex)).strip())
+    return None
+
+def run_batch(path: str, faustargs: List[str], defines: Dict[str, str], jobs: int) -> bool:
+    batch: List[BatchJob] = load_manifest(path, faustargs, defines)
+
+    failures: int = 0
+    with ProcessPoolExecutor(max_workers=jobs, initializer=init_worker,
+                             initargs=(faustpp.cache.get_cache_dir(),)) as pool:
+        for error in pool.map(run_job, batch):
+            if error is not None:
+                sys.stderr.write(error + '\n')
+                failures += 1
+
+    if failures > 0:
+        sys.stderr.write('%d of %d jobs have failed.\n' % (failures, len(batch)))
+    return failures == 0
@@ -0,0 +1,189 @@
+#          Copyright Jean Pierre Cimalando 2022.
+# Distributed under the Boost Software License, Version 1.0.
+#    (See accompanying file LICENSE or copy at
+#          http://www.boost.org/LICENSE_1_0.txt)
+#
+# SPDX-License-Identifier: BSL-1.0
+
+from typing import Optional, List, Set, Tuple, Callable
+from tempfile import mkdtemp
+import hashlib
+import shutil
+import json
+import re
+import os
+
+# The cache of the results of the faust compiler, on disk.
+#
+# A result is found by the hash of all what makes it: the contents of the DSP
+# file and of the libraries which it imports, the binary of the compiler and
+# its version, and the arguments. The arguments which name files, such as the
+# architecture, count by their contents, not by their paths.
+#
+# The entries are written in a temporary directory, which is then renamed, so
+# that several processes may fill the cache at the same time.
+
+# changes when the format of the entries changes
+CACHE_FORMAT: int = 1
+
+# the arguments of faust which are followed by the path of a file read
+FILE_ARGUMENTS = ('-a',)
+
+# the arguments of faust which are followed by a directory of the imports
+IMPORT_DIR_ARGUMENTS = ('-I', '-A')
+
+CACHE_DIR_: Optional[str] = None
+CACHE_DIR_SET_: bool = False
+
+def default_cache_dir() -> Optional[str]:
+    path: Optional[str] = os.getenv('FAUSTPP_CACHE_DIR')
+    if path is not None:
+        return path if len(path) > 0 else None
+    base: Optional[str] = os.getenv('XDG_CACHE_HOME')
+    if base is None or len(base) == 0:
+        base = os.path.join(os.path.expanduser('~'), '.cache')
+    return os.path.join(base, 'faustpp')
+
+def get_cache_dir() -> Optional[str]:
+    global CACHE_DIR_, CACHE_DIR_SET_
+    if not CACHE_DIR_SET_:
+        CACHE_DIR_ = default_cache_dir()
+        CACHE_DIR_SET_ = True
+    return CACHE_DIR_
+
+def set_cache_dir(path: Optional[str]):
+    # `None` disables the cache
+    global CACHE_DIR_, CACHE_DIR_SET_
+    CACHE_DIR_ = path
+    CACHE_DIR_SET_ = True
+
+def hash_file(path: str) -> str:
+    digest = hashlib.sha256()
+    with open(path, 'rb') as file:
+        for chunk in iter(lambda: file.read(1 << 16), b''):
+            digest.update(chunk)
+    return digest.hexdigest()
+
+def file_identity(path: str) -> str:
+    # a file which is not rewritten keeps its size and time, this spares the
+    # hash of the compiler binary at every run
+    st = os.stat(path)
+    return '%s:%d:%d' % (os.path.realpath(path), st.st_size, st.st_mtime_ns)
+
+reg_import = re.compile(r'\b(?:import|library|component)\s*\(\s*"([^"]+)"\s*\)')
+reg_comment = re.compile(r'//[^\n]*|/\*.*?\*/', re.DOTALL)
+
+def find_imports(dspfile: str, importdirs: List[str]) -> List[Tuple[str, str]]:
+    # the files imported by the DSP, recursively, as the pairs of their name
+    # and path, or of their name alone if they are not found
+    result: List[Tuple[str, str]] = []
+    seen: Set[str] = set()
+    pending: List[str] = [dspfile]
+    while len(pending) > 0:
+        path: str = pending.pop()
+        with open(path, 'r', errors='replace') as file:
+            text: str = reg_comment.sub('', file.read())
+        name: str
+        for name in reg_import.findall(text):
+            found: Optional[str] = None
+            for d in [os.path.dirname(path)] + importdirs:
+                candidate: str = os.path.join(d, name)
+                if os.path.isfile(candidate):
+                    found = os.path.realpath(candidate)
+                    break
+            key: str = found if found is not None else name
+            if key in seen:
+                continue
+            seen.add(key)
+            result.append((name, found or ''))
+            if found is not None:
+                pending.append(found)
+    return result
+
+def compute_key(dspfile: str, faustargs: List[str], faustid: str, libdirs: List[str]) -> str:
+    digest = hashlib.sha256()
+
+    def add(text: str):
+        digest.update(text.encode('utf-8'))
+        digest.update(b'\0')
+
+    add('format %d' % CACHE_FORMAT)
+    add(faustid)
+
+    importdirs: List[str] = []
+    i: int = 0
+    while i < len(faustargs):
+        arg: str = faustargs[i]
+        if arg in FILE_ARGUMENTS and i + 1 < len(faustargs):
+            add(arg)
+            add(hash_file(faustargs[i + 1]))
+            i += 2
+            continue
+        if arg in IMPORT_DIR_ARGUMENTS and i + 1 < len(faustargs):
+            importdirs.append(faustargs[i + 1])
+        add(arg)
+        i += 1
+
+    # the name is part of the generated code, as metadata
+    add(os.path.basename(dspfile))
+    add(hash_file(dspfile))
+    for name, path in find_imports(dspfile, importdirs + libdirs):
+        add(name)
+        add(hash_file(path) if len(path) > 0 else '')
+
+    return digest.hexdigest()
+
+def entry_path(key: str) -> Optional[str]:
+    cachedir: Optional[str] = get_cache_dir()
+    if cachedir is None:
+        return None
+    return os.path.join(cachedir, key[:2], key)
+
+def lookup(key: str, names: List[str]) -> Optional[List[str]]:
+    # the contents of the files of the entry, if it is complete
+    path: Optional[str] = entry_path(key)
+    if path is None or not os.path.isdir(path):
+        return None
+    contents: List[str] = []
+    try:
+        for name in names:
+            with open(os.path.join(path, name), 'r') as file:
+                contents.append(file.read())
+    except OSError:
+        return None
+    return contents
+
+def store(key: str, files: List[Tuple[str, str]]):
+    # failing to store is not an error, the result is just not cached
+    path: Optional[str] = entry_path(key)
+    if path is None:
+        return
+    try:
+        parent: str = os.path.dirname(path)
+        os.makedirs(parent, exist_ok=True)
+        temp: str = mkdtemp(prefix='.tmp-', dir=parent)
+        for name, content in files:
+            with open(os.path.join(temp, name), 'w') as file:
+                file.write(content)
+        try:
+            os.rename(temp, path)
+        except OSError:
+            # another process stored the same entry first
+            shutil.rmtree(temp, ignore_errors=True)
+    except OSError:
+        pass
+
+def cached_text(key: str, name: str, compute: Callable[[], str]) -> str:
+    # a single text, such as the output of `faust --version`
+    contents: Optional[List[str]] = lookup(key, [name])
+    if contents is not None:
+        return contents[0]
+    text: str = compute()
+    store(key, [(name, text)])
+    return text
+
+def identity_key(text: str) -> str:
+    return hashlib.sha256(('format %d\0%s' % (CACHE_FORMAT, text)).encode('utf-8')).hexdigest()
+
+def cached_json(key: str, compute: Callable[[], object]) -> object:
+    return json.loads(cached_text(key, 'value.json', lambda: json.dumps(compute())))
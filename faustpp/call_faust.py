@@ -6,10 +6,12 @@
 # SPDX-License-Identifier: BSL-1.0
 
 from faustpp.utility import parse_cstrlit, safe_element_text
-from typing import Optional, List, Dict
+import faustpp.cache
+from typing import Any, Optional, List, Dict
 from subprocess import run, CompletedProcess, PIPE
 from tempfile import TemporaryDirectory
 import xml.etree.ElementTree as ET
+import shutil
 import re
 import os
 import sys
@@ -42,13 +44,50 @@ def get_faust_command() -> str:
         FAUST_COMMAND_ = cmd
     return cmd
 
-def get_faust_version() -> FaustVersion:
+def get_faust_identity() -> Optional[str]:
+    # the identity of the binary of the compiler, for the cache
+    path: Optional[str] = shutil.which(get_faust_command())
+    if path is None:
+        return None
+    try:
+        return faustpp.cache.file_identity(path)
+    except OSError:
+        return None
+
+def query_faust_info() -> Dict[str, Any]:
     cmd: List[str] = [get_faust_command(), '--version']
     proc: CompletedProcess = run(cmd, stdout=PIPE)
     proc.check_returncode()
+    version: str = proc.stdout.decode('utf-8')
+
+    # the directory of the standard libraries, which older versions lack
+    libdirs: List[str] = []
+    proc = run([get_faust_command(), '--libdir'], stdout=PIPE, stderr=PIPE)
+    if proc.returncode == 0:
+        libdir: str = proc.stdout.decode('utf-8').strip()
+        if len(libdir) > 0 and os.path.isdir(libdir):
+            libdirs.append(libdir)
+
+    return {'version': version, 'libdirs': libdirs}
+
+FAUST_INFO_: Optional[Dict[str, Any]] = None
+
+def get_faust_info() -> Dict[str, Any]:
+    global FAUST_INFO_
+    info: Optional[Dict[str, Any]] = FAUST_INFO_
+    if info is None:
+        identity: Optional[str] = get_faust_identity()
+        if identity is None or faustpp.cache.get_cache_dir() is None:
+            info = query_faust_info()
+        else:
+            key: str = faustpp.cache.identity_key('faust ' + identity)
+            info = faustpp.cache.cached_json(key, query_faust_info)
+        FAUST_INFO_ = info
+    return info
 
+def get_faust_version() -> FaustVersion:
     reg = re.compile(r'(\d+)\.(\d+).(\d+)')
-    mat = reg.search(proc.stdout.decode('utf-8'))
+    mat = reg.search(get_faust_info()['version'])
     if mat is None:
         raise ValueError('Cannot extract the version of faust.')
 
@@ -69,27 +108,28 @@ class FaustResult:
     docmd: ET.ElementTree
 
 def call_faust(dspfile: str, faustargs: List[str]) -> FaustResult:
-    workdir = TemporaryDirectory()
-
-    dspfilebase = os.path.basename(dspfile)
-    xmlfilebase = dspfilebase + '.xml'
-    cppfilebase = dspfilebase + '.cpp'
-    xmlfile = os.path.join(workdir.name, xmlfilebase)
-    cppfile = os.path.join(workdir.name, cppfilebase)
-
-    fargv: List[str] = [
-        get_faust_command(),
-        "-O", workdir.name,
-        "-o", cppfilebase,
-        "-xml",
-        dspfile,
-    ] + faustargs
-
-    proc: CompletedProcess = run(fargv)
-    proc.check_returncode()
-
-    cppsource = open(cppfile, 'r').read()
-    docmd = ET.parse(xmlfile)
+    # the entry of the cache, if it is enabled
+    key: Optional[str] = None
+    identity: Optional[str] = get_faust_identity()
+    if identity is not None and faustpp.cache.get_cache_dir() is not None:
+        info: Dict[str, Any] = get_faust_info()
+        faustid: str = identity + '\0' + info['version']
+        libdirs: List[str] = os.getenv('FAUSTLIB', '').split(os.pathsep) + info['libdirs']
+        try:
+            key = faustpp.cache.compute_key(dspfile, faustargs, faustid, [d for d in libdirs if len(d) > 0])
+        except OSError:
+            key = None
+
+    contents: Optional[List[str]] = None
+    if key is not None:
+        contents = faustpp.cache.lookup(key, ['source.cpp', 'doc.xml'])
+    if contents is None:
+        contents = run_faust(dspfile, faustargs)
+        if key is not None:
+            faustpp.cache.store(key, [('source.cpp', contents[0]), ('doc.xml', contents[1])])
+
+    cppsource: str = contents[0]
+    docmd = ET.ElementTree(ET.fromstring(contents[1]))
     cppsource = apply_workarounds(cppsource, docmd)
 
     result = FaustResult()
@@ -97,6 +137,32 @@ def call_faust(dspfile: str, faustargs: List[str]) -> FaustResult:
     result.docmd = docmd
     return result
 
+def run_faust(dspfile: str, faustargs: List[str]) -> List[str]:
+    # the generated code, and the description in XML
+    with TemporaryDirectory() as workdir:
+        dspfilebase = os.path.basename(dspfile)
+        xmlfilebase = dspfilebase + '.xml'
+        cppfilebase = dspfilebase + '.cpp'
+        xmlfile = os.path.join(workdir, xmlfilebase)
+        cppfile = os.path.join(workdir, cppfilebase)
+
+        fargv: List[str] = [
+            get_faust_command(),
+            "-O", workdir,
+            "-o", cppfilebase,
+            "-xml",
+            dspfile,
+        ] + faustargs
+
+        proc: CompletedProcess = run(fargv)
+        proc.check_returncode()
+
+        with open(cppfile, 'r') as file:
+            cppsource: str = file.read()
+        with open(xmlfile, 'r') as file:
+            xmlsource: str = file.read()
+        return [cppsource, xmlsource]
+
 def apply_workarounds(cppsource: str, docmd: ET.ElementTree):
     line: str
     lines: List[str]
@@ -0,0 +1,256 @@
+#          Copyright Jean Pierre Cimalando 2022.
+# Distributed under the Boost Software License, Version 1.0.
+#    (See accompanying file LICENSE or copy at
+#          http://www.boost.org/LICENSE_1_0.txt)
+#
+# SPDX-License-Identifier: BSL-1.0
+
+from faustpp.metadata import Metadata
+from typing import Any, Optional, List, Dict, Tuple
+import re
+
+# The estimate of the resources of a DSP, from the analysis of the class which
+# the faust compiler generates.
+#
+# The state is the layout of the data members of the class, with the alignment
+# of their types, but without the pointer of the virtual table. The arrays of
+# the state hold the delay lines and the recursions. The tables are the static
+# arrays, which all the instances share. The operations are counted in the
+# loops over the samples of `compute`, as the operators, the conversions and
+# the selections, and apart from them, the calls of functions.
+
+# the sizes of the types of the generated code, on a usual 64-bit target
+TYPE_SIZES: Dict[str, int] = {
+    'bool': 1,
+    'char': 1,
+    'short': 2,
+    'int': 4,
+    'unsigned': 4,
+    'float': 4,
+    'FAUSTFLOAT': 4,
+    'int64_t': 8,
+    'uint64_t': 8,
+    'double': 8,
+    'long double': 16,
+    'quad': 16,
+}
+
+# the number of arrays listed as the largest
+LARGEST_ARRAYS: int = 5
+
+class Capacity:
+    state_bytes: int = 0
+    delay_bytes: int = 0
+    table_bytes: int = 0
+    ops_per_sample: int = 0
+    calls_per_sample: int = 0
+    largest_arrays: List[Dict[str, Any]]
+
+    def __init__(self):
+        self.largest_arrays = []
+
+    def to_dict(self) -> Dict[str, Any]:
+        return {
+            'state_bytes': self.state_bytes,
+            'delay_bytes': self.delay_bytes,
+            'table_bytes': self.table_bytes,
+            'ops_per_sample': self.ops_per_sample,
+            'calls_per_sample': self.calls_per_sample,
+            'largest_arrays': self.largest_arrays,
+        }
+
+class Declaration:
+    name: str
+    typename: str
+    count: int
+    is_array: bool
+    is_static: bool
+
+    def size(self) -> int:
+        return TYPE_SIZES[self.typename] * self.count
+
+reg_declaration = re.compile(
+    '^\\s*(static\\s+)?(?:const\\s+)?(%s)\\s+(\\w+)((?:\\s*\\[\\s*\\d+\\s*\\])*)\\s*;\\s*$' %
+    '|'.join(re.escape(t).replace('\\ ', '\\s+') for t in sorted(TYPE_SIZES, key=len, reverse=True)))
+reg_dimension = re.compile('\\[\\s*(\\d+)\\s*\\]')
+reg_operator = re.compile('\\+\\+|--|->|<<=?|>>=?|&&|\\|\\||[-+*/%&|^<>!=]=|[-+*/%&|^<>?~!]')
+reg_call = re.compile('\\b([A-Za-z_][\\w:]*)\\s*\\(')
+
+# the operators which do not compute
+NON_OPERATORS = ('++', '--', '->', '&&', '||', '!')
+
+# the words which are followed by a parenthesis, and are not calls
+NON_CALLS = ('for', 'if', 'while', 'switch', 'return', 'sizeof')
+
+def parse_declaration(line: str) -> Optional[Declaration]:
+    match = reg_declaration.match(line)
+    if match is None:
+        return None
+    decl = Declaration()
+    decl.is_static = match.group(1) is not None
+    decl.typename = ' '.join(match.group(2).split())
+    decl.name = match.group(3)
+    dimensions: List[int] = [int(d) for d in reg_dimension.findall(match.group(4))]
+    decl.is_array = len(dimensions) > 0
+    decl.count = 1
+    for d in dimensions:
+        decl.count *= d
+    return decl
+
+def find_block(code: str, start: int) -> Tuple[int, int]:
+    # the range of the braced block which opens at or after `start`
+    begin: int = code.index('{', start)
+    depth: int = 0
+    for index in range(begin, len(code)):
+        if code[index] == '{':
+            depth += 1
+        elif code[index] == '}':
+            depth -= 1
+            if depth == 0:
+                return (begin + 1, index)
+    raise ValueError('Unbalanced braces in the generated code')
+
+def top_level_lines(code: str) -> List[str]:
+    # the lines of a block which are outside of any nested block
+    lines: List[str] = []
+    depth: int = 0
+    current: str = ''
+    for c in code:
+        if c == '{':
+            depth += 1
+        elif c == '}':
+            depth -= 1
+        elif depth == 0:
+            if c == '\n':
+                lines.append(current)
+                current = ''
+            else:
+                current += c
+    lines.append(current)
+    return lines
+
+def find_loops(code: str) -> List[Tuple[str, str]]:
+    # the header and the body of the loops at the top level of a block
+    loops: List[Tuple[str, str]] = []
+    reg_for = re.compile('\\bfor\\s*\\(')
+    index: int = 0
+    while True:
+        match = reg_for.search(code, index)
+        if match is None:
+            break
+        # skip the loops nested in the body of a previous one
+        if code.count('{', 0, match.start()) != code.count('}', 0, match.start()):
+            index = match.end()
+            continue
+        close: int = code.index(')', match.end())
+        while code.count('(', match.start(), close + 1) != code.count(')', match.start(), close + 1):
+            close = code.index(')', close + 1)
+        body: Tuple[int, int] = find_block(code, close)
+        loops.append((code[match.start():close + 1], code[body[0]:body[1]]))
+        index = body[1] + 1
+    return loops
+
+def count_operations(code: str) -> Tuple[int, int]:
+    code = re.sub('\\d+\\.?\\d*(?:[eE][-+]?\\d+)?f?', '0', code)
+    ops: int = 0
+    calls: int = 0
+    for op in reg_operator.findall(code):
+        if op not in NON_OPERATORS:
+            ops += 1
+    for name in reg_call.findall(code):
+        if name in NON_CALLS:
+            continue
+        elif name in TYPE_SIZES:
+            # a conversion
+            ops += 1
+        else:
+            calls += 1
+    return (ops, calls)
+
+def sample_loops(compute: str) -> List[str]:
+    # the bodies of the loops over the samples: the first loop of `compute`,
+    # or in the vector mode, the loops over the samples of a vector in the
+    # first loop, the next being the copy for the remaining frames
+    loops: List[Tuple[str, str]] = find_loops(compute)
+    if len(loops) == 0:
+        return []
+    header, body = loops[0]
+    inner: List[Tuple[str, str]] = find_loops(body)
+    if len(inner) == 0:
+        return [body]
+    return [b for h, b in inner if 'vsize' in h]
+
+def analyze_class_code(code: str, classname: str) -> Capacity:
+    cap = Capacity()
+    arrays: List[Declaration] = []
+
+    match = re.search('\\bclass\\s+%s\\s*:' % re.escape(classname), code)
+    if match is None:
+        return cap
+    body: Tuple[int, int] = find_block(code, match.end())
+
+    # the data members
+    alignment: int = 1
+    line: str
+    for line in top_level_lines(code[body[0]:body[1]]):
+        decl: Optional[Declaration] = parse_declaration(line)
+        if decl is None:
+            continue
+        if decl.is_static:
+            if decl.is_array:
+                cap.table_bytes += decl.size()
+                arrays.append(decl)
+            continue
+        align: int = TYPE_SIZES[decl.typename]
+        alignment = max(alignment, align)
+        cap.state_bytes = (cap.state_bytes + align - 1) // align * align + decl.size()
+        if decl.is_array:
+            cap.delay_bytes += decl.size()
+            arrays.append(decl)
+    cap.state_bytes = (cap.state_bytes + alignment - 1) // alignment * alignment
+
+    # the static tables, outside of the class
+    for line in top_level_lines(code[:match.start()] + '\n' + code[body[1] + 1:]):
+        decl = parse_declaration(line)
+        if decl is not None and decl.is_static and decl.is_array:
+            cap.table_bytes += decl.size()
+            arrays.append(decl)
+
+    arrays.sort(key=lambda d: d.size(), reverse=True)
+    for decl in arrays[:LARGEST_ARRAYS]:
+        cap.largest_arrays.append({
+            'name': decl.name,
+            'type': decl.typename,
+            'count': decl.count,
+            'bytes': decl.size(),
+            'static': decl.is_static,
+        })
+
+    # the operations
+    match = re.search('\\bvoid\\s+compute\\s*\\(\\s*int\\b', code[body[0]:body[1]])
+    if match is not None:
+        compute: Tuple[int, int] = find_block(code, body[0] + match.end())
+        for loop in sample_loops(code[compute[0]:compute[1]]):
+            ops, calls = count_operations(loop)
+            cap.ops_per_sample += ops
+            cap.calls_per_sample += calls
+
+    return cap
+
+def analyze_metadata(md: Metadata) -> Capacity:
+    return analyze_class_code(md.class_code, md.classname)
+
+def capacity_report(md: Metadata) -> Dict[str, Any]:
+    report: Dict[str, Any] = {
+        'dsp': md.filename,
+        'class': md.classname,
+        'inputs': md.inputs,
+        'outputs': md.outputs,
+    }
+    report.update(analyze_metadata(md).to_dict())
+    if len(md.parts) > 0:
+        parts: Dict[str, Any] = {}
+        for role, part in md.parts.items():
+            parts[role] = analyze_metadata(part).to_dict()
+        report['parts'] = parts
+    return report
@@ -0,0 +1,150 @@
+#          Copyright Jean Pierre Cimalando 2022.
+# Distributed under the Boost Software License, Version 1.0.
+#    (See accompanying file LICENSE or copy at
+#          http://www.boost.org/LICENSE_1_0.txt)
+#
+# SPDX-License-Identifier: BSL-1.0
+
+# Design of the linear-phase FIR filters used for resampling, by the Kaiser
+# window method. The specification is the same as for the hiir filters, so
+# that either kind can be designed from the same options.
+
+from typing import List
+import math
+
+def compute_halfband_coefs(attenuation: float, transition: float) -> List[float]:
+    # The half-band filter has 4*N-1 taps. All the taps at an odd distance
+    # from the center are zero except the center itself, which is 1/2.
+    # The remaining taps are symmetric, and only the first N are returned.
+    ntaps: int = compute_kaiser_length(attenuation, transition)
+    n: int = max(1, int(math.ceil((ntaps + 1) / 4)))
+    beta: float = compute_kaiser_beta(attenuation)
+
+    # the length estimate is approximate, lengthen until it meets the spec
+    coefs: List[float] = design_halfband(n, beta)
+    while compute_halfband_attenuation(coefs, transition) < attenuation:
+        n += 1
+        coefs = design_halfband(n, beta)
+
+    return coefs
+
+def design_halfband(n: int, beta: float) -> List[float]:
+    length: int = 4 * n - 1
+    center: int = 2 * n - 1
+
+    coefs: List[float] = []
+    for q in range(n):
+        i: int = 2 * q
+        d: int = i - center
+        h: float = math.sin(math.pi * d / 2) / (math.pi * d)
+        coefs.append(h * compute_kaiser_window(i, length, beta))
+
+    # normalize for unity gain at DC in each polyphase branch
+    gain: float = 2 * sum(coefs)
+    return [c * 0.5 / gain for c in coefs]
+
+def compute_halfband_attenuation(coefs: List[float], transition: float) -> float:
+    n: int = len(coefs)
+    taps: List[float] = [0.0] * (4 * n - 1)
+    taps[2 * n - 1] = 0.5
+    for q in range(n):
+        taps[2 * q] = taps[4 * n - 2 - 2 * q] = coefs[q]
+    return compute_stopband_attenuation(taps, 0.25 + transition / 2)
+
+def compute_halfband_delay(coefs: List[float]) -> int:
+    # the delay of the half-band filter, at the higher rate
+    return 2 * len(coefs) - 1
+
+def compute_thirdband_coefs(attenuation: float, transition: float) -> List[float]:
+    # The third-band filter has 6*N-1 taps. All the taps at a distance from
+    # the center which is a multiple of 3 are zero except the center itself,
+    # which is 1/3. Of the two other polyphase branches, each is the reverse
+    # of the other, and the 2*N coefficients of the first are returned.
+    if transition >= 1.0 / 3.0:
+        raise ValueError('The transition bandwidth is out of range')
+    ntaps: int = compute_kaiser_length(attenuation, transition)
+    n: int = max(1, int(math.ceil((ntaps + 1) / 6)))
+    beta: float = compute_kaiser_beta(attenuation)
+
+    # the length estimate is approximate, lengthen until it meets the spec
+    coefs: List[float] = design_thirdband(n, beta)
+    while compute_thirdband_attenuation(coefs, transition) < attenuation:
+        n += 1
+        coefs = design_thirdband(n, beta)
+
+    return coefs
+
+def design_thirdband(n: int, beta: float) -> List[float]:
+    length: int = 6 * n - 1
+    center: int = 3 * n - 1
+
+    coefs: List[float] = []
+    for q in range(2 * n):
+        i: int = 3 * q
+        d: int = i - center
+        h: float = math.sin(math.pi * d / 3) / (math.pi * d)
+        coefs.append(h * compute_kaiser_window(i, length, beta))
+
+    # normalize for unity gain at DC in each polyphase branch
+    gain: float = sum(coefs)
+    return [c / (3 * gain) for c in coefs]
+
+def compute_thirdband_attenuation(coefs: List[float], transition: float) -> float:
+    n: int = len(coefs) // 2
+    taps: List[float] = [0.0] * (6 * n - 1)
+    taps[3 * n - 1] = 1.0 / 3.0
+    for q in range(2 * n):
+        taps[3 * q] = taps[6 * n - 2 - 3 * q] = coefs[q]
+    return compute_stopband_attenuation(taps, 1.0 / 6.0 + transition / 2)
+
+def compute_thirdband_delay(coefs: List[float]) -> int:
+    # the delay of the third-band filter, at the higher rate
+    return 3 * len(coefs) // 2 - 1
+
+def compute_stopband_attenuation(taps: List[float], f1: float) -> float:
+    # measure the stopband attenuation of a symmetric filter on a grid, in dB
+    center: int = (len(taps) - 1) // 2
+    peak: float = 0.0
+    npoints: int = 256
+    for k in range(npoints + 1):
+        w: float = 2 * math.pi * (f1 + (0.5 - f1) * k / npoints)
+        # zero-phase response, using the symmetry around the center
+        h: float = taps[center]
+        for i in range(center):
+            if taps[i] != 0.0:
+                h += 2 * taps[i] * math.cos(w * (center - i))
+        peak = max(peak, abs(h))
+    return -20 * math.log10(max(peak, 1e-15))
+
+def compute_kaiser_length(attenuation: float, transition: float) -> int:
+    if attenuation <= 0:
+        raise ValueError('The attenuation is out of range')
+    if transition <= 0 or transition >= 0.5:
+        raise ValueError('The transition bandwidth is out of range')
+    order: float = (attenuation - 7.95) / (14.36 * transition)
+    return max(3, int(math.ceil(order)) + 1)
+
+def compute_kaiser_beta(attenuation: float) -> float:
+    if attenuation > 50:
+        return 0.1102 * (attenuation - 8.7)
+    elif attenuation >= 21:
+        return 0.5842 * math.pow(attenuation - 21, 0.4) + 0.07886 * (attenuation - 21)
+    else:
+        return 0.0
+
+def compute_kaiser_window(index: int, length: int, beta: float) -> float:
+    r: float = 2.0 * index / (length - 1) - 1.0
+    return bessel_i0(beta * math.sqrt(max(0.0, 1.0 - r * r))) / bessel_i0(beta)
+
+def bessel_i0(x: float) -> float:
+    # power series of the modified Bessel function of the first kind
+    acc: float = 1.0
+    term: float = 1.0
+    k: int = 1
+    while True:
+        term *= (x / (2 * k)) * (x / (2 * k))
+        acc += term
+        k += 1
+        if term < acc * 1e-17:
+            break
+    return acc
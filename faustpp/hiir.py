@@ -0,0 +1,129 @@
+#          Copyright Jean Pierre Cimalando 2022.
+# Distributed under the Boost Software License, Version 1.0.
+#    (See accompanying file LICENSE or copy at
+#          http://www.boost.org/LICENSE_1_0.txt)
+#
+# SPDX-License-Identifier: BSL-1.0
+
+# Design of the half-band polyphase IIR filters of the hiir library,
+# translated from `hiir::PolyphaseIir2Designer` (Laurent de Soras, WTFPL).
+#
+# The design runs at generation time, so the number of coefficients, which is
+# a template argument of the hiir up/downsamplers, is known to the template.
+
+from typing import List, Tuple
+import math
+
+def compute_nbr_coefs_from_proto(attenuation: float, transition: float) -> int:
+    k, q = compute_transition_param(transition)
+    order: int = compute_order(attenuation, q)
+    return (order - 1) // 2
+
+def compute_atten_from_order_tbw(nbr_coefs: int, transition: float) -> float:
+    k, q = compute_transition_param(transition)
+    order: int = nbr_coefs * 2 + 1
+    return compute_atten(q, order)
+
+def compute_coefs(attenuation: float, transition: float) -> List[float]:
+    k, q = compute_transition_param(transition)
+    order: int = compute_order(attenuation, q)
+    nbr_coefs: int = (order - 1) // 2
+    return [compute_coef(index, k, q, order) for index in range(nbr_coefs)]
+
+def compute_coefs_spec_order_tbw(nbr_coefs: int, transition: float) -> List[float]:
+    k, q = compute_transition_param(transition)
+    order: int = nbr_coefs * 2 + 1
+    return [compute_coef(index, k, q, order) for index in range(nbr_coefs)]
+
+def compute_group_delay(coefs: List[float], f_fs: float = 0.0, ph_flag: bool = False) -> float:
+    if f_fs < 0 or f_fs >= 0.5:
+        raise ValueError('The frequency is out of range')
+
+    w: float = 2 * math.pi * f_fs
+    sig: float = -2 if ph_flag else 2
+
+    dly_total: float = 0
+    for a in coefs:
+        a2: float = a * a
+        dly_total += 2 * (1 - a2) / (a2 + sig * a * math.cos(2 * w) + 1)
+
+    return dly_total
+
+def compute_halfband_delay(coefs: List[float], f_fs: float = 0.0) -> float:
+    # the delay of the complete half-band filter, at the higher rate, the
+    # group delay of the allpass chains being counted at the lower rate
+    return compute_group_delay(coefs, f_fs) / 2
+
+def compute_transition_param(transition: float) -> Tuple[float, float]:
+    if transition <= 0 or transition >= 0.5:
+        raise ValueError('The transition bandwidth is out of range')
+
+    k: float = math.tan((1 - transition * 2) * math.pi / 4)
+    k *= k
+    kksqrt: float = math.pow(1 - k * k, 0.25)
+    e: float = 0.5 * (1 - kksqrt) / (1 + kksqrt)
+    e2: float = e * e
+    e4: float = e2 * e2
+    q: float = e * (1 + e4 * (2 + e4 * (15 + 150 * e4)))
+    return (k, q)
+
+def compute_order(attenuation: float, q: float) -> int:
+    if attenuation <= 0:
+        raise ValueError('The attenuation is out of range')
+
+    attn_p2: float = math.pow(10.0, -attenuation / 10)
+    a: float = attn_p2 / (1 - attn_p2)
+    order: int = int(math.ceil(math.log(a * a / 16) / math.log(q)))
+    if (order & 1) == 0:
+        order += 1
+    if order == 1:
+        order = 3
+    return order
+
+def compute_atten(q: float, order: int) -> float:
+    a: float = 4 * math.exp(order * 0.5 * math.log(q))
+    attn_p2: float = a / (1 + a)
+    return -10 * math.log10(attn_p2)
+
+def compute_coef(index: int, k: float, q: float, order: int) -> float:
+    c: int = index + 1
+    num: float = compute_acc_num(q, order, c) * math.pow(q, 0.25)
+    den: float = compute_acc_den(q, order, c) + 0.5
+    ww: float = num / den
+    wwsq: float = ww * ww
+
+    x: float = math.sqrt((1 - wwsq * k) * (1 - wwsq / k)) / (1 + wwsq)
+    return (1 - x) / (1 + x)
+
+def compute_acc_num(q: float, order: int, c: int) -> float:
+    i: int = 0
+    j: int = 1
+    acc: float = 0
+    while True:
+        q_ii1: float = math.pow(q, i * (i + 1))
+        q_ii1 *= math.sin((i * 2 + 1) * c * math.pi / order) * j
+        acc += q_ii1
+        j = -j
+        i += 1
+        if abs(q_ii1) <= 1e-100:
+            break
+    return acc
+
+def compute_acc_den(q: float, order: int, c: int) -> float:
+    i: int = 1
+    j: int = -1
+    acc: float = 0
+    while True:
+        q_i2: float = math.pow(q, i * i)
+        q_i2 *= math.cos(i * 2 * c * math.pi / order) * j
+        acc += q_i2
+        j = -j
+        i += 1
+        if abs(q_i2) <= 1e-100:
+            break
+    return acc
+
+def next_stage_transition(transition: float) -> float:
+    # relaxes the transition band of a 2x stage which follows another in a
+    # cascade, as explained in section 5 of the hiir documentation
+    return (transition + 0.5) / 2
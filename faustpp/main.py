@@ -6,13 +6,18 @@
 # SPDX-License-Identifier: BSL-1.0
 
 from faustpp.call_faust import FaustVersion, ensure_faust_version, FaustResult, call_faust
-from faustpp.metadata import Metadata, extract_metadata
+from faustpp.metadata import Metadata, extract_metadata, SPLIT_ROLES
 from faustpp.render import render_metadata
+from faustpp.capacity import capacity_report
+import faustpp.autotune
+import faustpp.cache
+import faustpp.batch
 from argparse import ArgumentParser, Namespace
 from typing import Optional, TextIO, List, Dict
 from tempfile import NamedTemporaryFile
 from contextlib import ExitStack
 import importlib.resources
+import json
 import os
 import sys
 
@@ -22,6 +27,11 @@ class CmdArgs:
     dspfile: str
     defines: Dict[str, str]
     faustargs: List[str]
+    reportfile: Optional[str]
+    batchfile: Optional[str]
+    jobs: int
+    autotune: bool
+    tune: 'faustpp.autotune.TuneOptions'
 
 class CmdError(Exception):
     pass
@@ -32,19 +42,21 @@ def main(args=sys.argv):
 
         ensure_faust_version(FaustVersion(0, 9, 85))
 
-        with NamedTemporaryFile('w', suffix='.cpp') as mdfile:
-            mdfile.write("""<<<<BeginFaustClass>>>>
-<<includeIntrinsic>>
-<<includeclass>>
-<<<<EndFaustClass>>>>""")
-            mdfile.flush()
+        if cmd.batchfile is not None:
+            if not faustpp.batch.run_batch(cmd.batchfile, cmd.faustargs, cmd.defines, cmd.jobs):
+                sys.exit(1)
+            return
 
-            mdargs: List[str] = cmd.faustargs + ['-a', mdfile.name]
-            mdresult: FaustResult = call_faust(cmd.dspfile, mdargs)
+        if cmd.autotune:
+            faustpp.autotune.autotune(cmd.dspfile, cmd.faustargs, cmd.tune)
+            return
 
-            md: Metadata = extract_metadata(mdresult.docmd, mdresult.cppsource)
+        md: Metadata = compile_metadata(cmd.dspfile, cmd.faustargs)
 
-        md.filename = os.path.basename(cmd.dspfile)
+        if cmd.reportfile is not None:
+            write_report(cmd.reportfile, md)
+            if cmd.tmplfile is None:
+                return
 
         #
         success = False
@@ -67,19 +79,75 @@ def main(args=sys.argv):
 
         success = True
 
+def compile_metadata(dspfile: str, faustargs: List[str]) -> Metadata:
+    with NamedTemporaryFile('w', suffix='.cpp') as mdfile:
+        mdfile.write("""<<<<BeginFaustClass>>>>
+<<includeIntrinsic>>
+<<includeclass>>
+<<<<EndFaustClass>>>>""")
+        mdfile.flush()
+
+        mdargs: List[str] = faustargs + ['-a', mdfile.name]
+        mdresult: FaustResult = call_faust(dspfile, mdargs)
+
+        md: Metadata = extract_metadata(mdresult.docmd, mdresult.cppsource)
+
+        # compile the sections of a split DSP, if it declares some
+        role: str
+        for role in SPLIT_ROLES:
+            procname: Optional[str] = md.find_metadata('oversampling_' + role)
+            if procname is None:
+                continue
+            partargs: List[str] = faustargs + [
+                '-pn', procname, '-cn', md.classname + '_' + role, '-a', mdfile.name]
+            partresult: FaustResult = call_faust(dspfile, partargs)
+            md.parts[role] = extract_metadata(partresult.docmd, partresult.cppsource)
+
+    md.filename = os.path.basename(dspfile)
+    return md
+
+def write_report(path: str, md: Metadata):
+    text: str = json.dumps(capacity_report(md), indent=2) + '\n'
+    if path == '-':
+        sys.stdout.write(text)
+    else:
+        with open(path, 'w') as out:
+            out.write(text)
+
 def do_cmdline(args: List[str]) -> CmdArgs:
     parser: ArgumentParser = ArgumentParser(description='A post-processor for the faust compiler')
     parser.add_argument(('-a'), metavar='tmplfile', dest='tmplfile', help='architecture file')
     parser.add_argument(('-o'), metavar='outfile', dest='outfile', help='output file')
     parser.add_argument(('-D'), metavar='defines', dest='defines', action='append', help='definition, in the form name=value')
     parser.add_argument(('-X'), metavar='faustargs', dest='faustargs', action='append', help='extra faust compiler argument')
-    parser.add_argument('dspfile', help='source file')
+    parser.add_argument(('-F'), metavar='flagsfile', dest='flagsfile', help='faust compiler arguments, from the result of --autotune')
+    parser.add_argument('--report', metavar='reportfile', dest='reportfile', help='write an estimate of the resources of the DSP, in JSON')
+    parser.add_argument('--cache-dir', metavar='cachedir', dest='cachedir', help='directory of the cache of the faust results, by default from FAUSTPP_CACHE_DIR or ~/.cache/faustpp')
+    parser.add_argument('--no-cache', action='store_true', dest='nocache', help='always run the faust compiler')
+    parser.add_argument('--batch', metavar='manifest', dest='batchfile', help='generate the files listed in a manifest, instead of a single file')
+    parser.add_argument('dspfile', nargs='?', help='source file')
+
+    tuning = parser.add_argument_group('autotuning', 'search the faust compiler arguments which make the fastest code')
+    tuning.add_argument('--autotune', action='store_true', help='search the arguments, and write them to the output file')
+    parser.add_argument('--jobs', type=int, default=os.cpu_count() or 1, help='number of variants compiled in parallel, or of DSPs generated in parallel with --batch')
+    tuning.add_argument('--cxx', default=os.getenv('CXX', 'c++'), help='C++ compiler of the variants')
+    tuning.add_argument('--cxxflags', default=os.getenv('CXXFLAGS', '-O3'), help='C++ compiler flags of the variants')
+    tuning.add_argument('--block', type=int, default=256, help='block size of the benchmark')
+    tuning.add_argument('--duration', type=float, default=2.0, help='duration of audio of each benchmark, in seconds')
+    tuning.add_argument('--repeat', type=int, default=3, help='number of runs of each benchmark, of which the fastest is kept')
 
     result: Namespace = parser.parse_args(args[1:])
 
-    if result.tmplfile is None:
+    if result.batchfile is None and result.dspfile is None:
+        raise CmdError("No source file has been specified.\n")
+    if result.tmplfile is None and result.reportfile is None and result.batchfile is None and not result.autotune:
         raise CmdError("No architecture file has been specified.\n")
 
+    if result.nocache:
+        faustpp.cache.set_cache_dir(None)
+    elif result.cachedir is not None:
+        faustpp.cache.set_cache_dir(result.cachedir)
+
     cmd = CmdArgs()
 
     cmd.tmplfile = result.tmplfile
@@ -87,6 +155,25 @@ def do_cmdline(args: List[str]) -> CmdArgs:
     cmd.dspfile = result.dspfile
     cmd.defines = {}
     cmd.faustargs = []
+    cmd.reportfile = result.reportfile
+    cmd.batchfile = result.batchfile
+    cmd.jobs = max(1, result.jobs)
+    cmd.autotune = result.autotune
+
+    cmd.tune = faustpp.autotune.TuneOptions()
+    cmd.tune.outfile = result.outfile
+    cmd.tune.jobs = max(1, result.jobs)
+    cmd.tune.cxx = result.cxx
+    cmd.tune.cxxflags = result.cxxflags
+    cmd.tune.block = result.block
+    cmd.tune.duration = result.duration
+    cmd.tune.repeat = max(1, result.repeat)
+
+    # the tuned arguments come first, so the explicit ones can override them
+    if result.flagsfile is not None:
+        cmd.faustargs += faustpp.autotune.load_flags(result.flagsfile)
+    if result.faustargs is not None:
+        cmd.faustargs += result.faustargs
 
     if result.defines is not None:
         defi: str
@@ -102,7 +189,7 @@ def do_cmdline(args: List[str]) -> CmdArgs:
 def find_template_file(name: str) -> str:
     # if missing, search in package resources
     if not os.path.isfile(name):
-        pkgname : str = __name__[0:name.rindex('.')]
+        pkgname : str = __name__[0:__name__.rindex('.')]
         with importlib.resources.path(pkgname, 'architectures') as arcdir:
             path : str = os.path.join(arcdir, name)
             if os.path.isfile(path):
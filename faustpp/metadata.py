@@ -6,7 +6,7 @@
 # SPDX-License-Identifier: BSL-1.0
 
 from faustpp.utility import safe_element_text, safe_element_attribute, is_decint_string, parse_cfloat
-from typing import List, Tuple
+from typing import List, Tuple, Dict, Optional
 import xml.etree.ElementTree as ET
 import re
 
@@ -21,6 +21,9 @@ WIDGET_HBarGraph = 6
 WTYPE_Active = 0
 WTYPE_Passive = 1
 
+# the sections of a DSP split around its oversampled part, in signal order
+SPLIT_ROLES = ('pre', 'core', 'post')
+
 SCALE_Linear = 0
 SCALE_Log = 1
 SCALE_Exp = 2
@@ -61,6 +64,15 @@ class Metadata:
 
     class_code: str
 
+    parts: Dict[str, 'Metadata']
+
+    def find_metadata(self, key: str) -> Optional[str]:
+        meta: Tuple[str, str]
+        for meta in self.metadata:
+            if meta[0] == key:
+                return meta[1]
+        return None
+
 def extract_metadata(doc: ET.ElementTree, mdsource: str) -> Metadata:
     root: ET.Element = doc.getroot()
 
@@ -166,6 +178,7 @@ def extract_metadata(doc: ET.ElementTree, mdsource: str) -> Metadata:
         "#endif" "\n"
 
     md.class_code = ccode
+    md.parts = {}
 
     return md
 
@@ -7,16 +7,33 @@
 
 from faustpp.metadata import Metadata, WTYPE_Active, WTYPE_Passive
 from faustpp.utility import cstrlit, mangle
+from faustpp.capacity import analyze_metadata
+import faustpp.hiir
+import faustpp.fir
 from typing import Any, Optional, TextIO, List, Dict, Tuple
 from jinja2 import Environment, FileSystemLoader
+import threading
 import os
 
 class RenderFailure(Exception):
     pass
 
+# the environments by the directory of their templates, which are kept so
+# that the templates are compiled once, when a process renders many files
+ENVIRONMENTS_: Dict[str, Environment] = {}
+ENVIRONMENTS_LOCK_ = threading.Lock()
+
+def get_environment(tmpldir: str) -> Environment:
+    with ENVIRONMENTS_LOCK_:
+        env: Optional[Environment] = ENVIRONMENTS_.get(tmpldir)
+        if env is None:
+            env = Environment(loader=FileSystemLoader(tmpldir))
+            ENVIRONMENTS_[tmpldir] = env
+        return env
+
 def render_metadata(out: TextIO, md: Metadata, tmplfile: str, defines: Dict[str, str]):
     tmpldir: str = os.path.dirname(tmplfile)
-    env = Environment(loader=FileSystemLoader(tmpldir))
+    env: Environment = get_environment(tmpldir)
     template = env.get_template(os.path.basename(tmplfile))
 
     context: Dict[str, Any] = make_global_environment(md, defines)
@@ -24,6 +41,32 @@ def render_metadata(out: TextIO, md: Metadata, tmplfile: str, defines: Dict[str,
     out.write(template.render(context))
 
 def make_global_environment(md: Metadata, defines: Dict[str, str]) -> Dict[str, Any]:
+    context: Dict[str, Any] = make_dsp_environment(md)
+
+    parts: Dict[str, Any] = {}
+    for role, part in md.parts.items():
+        parts[role] = make_dsp_environment(part)
+    context["parts"] = parts
+
+    context["cstr"] = cstrlit
+    context["cid"] = mangle
+    context["hiir"] = faustpp.hiir
+    context["fir"] = faustpp.fir
+
+    def fail(msg: str):
+        if len(msg) == 0:
+            msg = "failure without a message";
+        raise RenderFailure(msg);
+    context["fail"] = fail
+
+    key: str
+    val: str
+    for key, val in defines.items():
+        context[key] = parse_value_string(val)
+
+    return context;
+
+def make_dsp_environment(md: Metadata) -> Dict[str, Any]:
     context: Dict[str, Any] = {}
 
     context["class_code"] = md.class_code;
@@ -37,6 +80,7 @@ def make_global_environment(md: Metadata, defines: Dict[str, str]) -> Dict[str,
     context["file_name"] = md.filename;
     context["inputs"] = int(md.inputs);
     context["outputs"] = int(md.outputs);
+    context["capacity"] = analyze_metadata(md).to_dict()
 
     meta: Tuple[str, str]
 
@@ -85,20 +129,6 @@ def make_global_environment(md: Metadata, defines: Dict[str, str]) -> Dict[str,
         elif wtype == WTYPE_Passive:
             context["passive"] = widget_list_obj
 
-    context["cstr"] = cstrlit
-    context["cid"] = mangle
-
-    def fail(msg: str):
-        if len(msg) == 0:
-            msg = "failure without a message";
-        raise RenderFailure(msg);
-    context["fail"] = fail
-
-    key: str
-    val: str
-    for key, val in defines.items():
-        context[key] = parse_value_string(val)
-
     return context;
 
 def parse_value_string(value: str) -> Any:
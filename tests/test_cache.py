@@ -0,0 +1,69 @@
+#          Copyright Jean Pierre Cimalando 2022.
+# Distributed under the Boost Software License, Version 1.0.
+#    (See accompanying file LICENSE or copy at
+#          http://www.boost.org/LICENSE_1_0.txt)
+#
+# SPDX-License-Identifier: BSL-1.0
+
+from typing import Dict
+import faustpp.cache
+import tempfile
+import unittest
+import os
+
+# The key of the cache, which must change with each file that the DSP reads,
+# whether it is imported, loaded as a library, or loaded as a component, and
+# with the files which these read in turn.
+
+FILES: Dict[str, str] = {
+    'main.dsp':
+        'import("imported.lib");\n'
+        'lib = library("library.lib");\n'
+        'process = component("component.dsp") : lib.f : g;\n',
+    'imported.lib': 'g = *(0.5);\n',
+    'library.lib': 'import("nested.lib");\nf = h;\n',
+    'nested.lib': 'h = _;\n',
+    'component.dsp': 'process = _;\n',
+    'unused.lib': 'u = _;\n',
+}
+
+class TestCacheKey(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        for name, text in FILES.items():
+            self.write(name, text)
+
+    def tearDown(self):
+        self.directory.cleanup()
+
+    def path(self, name: str) -> str:
+        return os.path.join(self.directory.name, name)
+
+    def write(self, name: str, text: str):
+        with open(self.path(name), 'w') as file:
+            file.write(text)
+
+    def key(self) -> str:
+        return faustpp.cache.compute_key(self.path('main.dsp'), ['-double'], 'faust', [])
+
+    def test_dependencies(self):
+        for name in ('imported.lib', 'library.lib', 'nested.lib', 'component.dsp'):
+            with self.subTest(dependency=name):
+                before: str = self.key()
+                self.write(name, FILES[name] + '// edited\n')
+                self.assertNotEqual(self.key(), before)
+
+    def test_unrelated(self):
+        before: str = self.key()
+        self.write('unused.lib', FILES['unused.lib'] + '// edited\n')
+        self.assertEqual(self.key(), before)
+
+    def test_comment(self):
+        # a dependency in a comment is not read by faust
+        self.write('main.dsp', FILES['main.dsp'] + '// component("unused.lib")\n')
+        before: str = self.key()
+        self.write('unused.lib', FILES['unused.lib'] + '// edited\n')
+        self.assertEqual(self.key(), before)
+
+if __name__ == '__main__':
+    unittest.main()
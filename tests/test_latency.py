@@ -0,0 +1,104 @@
+#          Copyright Jean Pierre Cimalando 2022.
+# Distributed under the Boost Software License, Version 1.0.
+#    (See accompanying file LICENSE or copy at
+#          http://www.boost.org/LICENSE_1_0.txt)
+#
+# SPDX-License-Identifier: BSL-1.0
+
+from typing import List, Tuple
+import subprocess
+import tempfile
+import unittest
+import shutil
+import sys
+import os
+
+# The latency which the oversampled template reports, against the delay of a
+# sine rendered through a module which passes its input. The sine is of a low
+# frequency, where the delay of the filters is the one computed at DC, and of
+# a period longer than this delay.
+
+ROOT: str = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+FAUST: str = os.getenv('FAUST', 'faust')
+CXX: str = os.getenv('CXX', 'c++')
+
+# the ratios and the types of the filters which are measured
+CASES: List[Tuple[str, str]] = [
+    ('2', 'iir'), ('3', 'iir'), ('4', 'iir'), ('6', 'iir'), ('8', 'iir'), ('16', 'iir'),
+    ('1/2', 'iir'), ('1/4', 'iir'), ('2', 'fir'), ('4', 'fir'), ('1/2', 'fir'),
+]
+
+# the maximal error of the measure, in samples
+TOLERANCE: float = 0.05
+
+MAIN_SOURCE: str = r'''
+#include "Latency.hpp"
+#include <cmath>
+#include <cstdio>
+
+int main()
+{
+    const double pi = 3.14159265358979323846;
+    const unsigned period = 8192;
+    const unsigned skip = 4 * period;
+    const unsigned length = skip + 16 * period;
+    const double w = 2 * pi / period;
+
+    Latency dsp;
+    dsp.init(48000);
+
+    double s = 0, c = 0;
+    const unsigned block = 64;
+    float in[block], out[block];
+    for (unsigned n = 0; n < length; n += block) {
+        for (unsigned i = 0; i < block; ++i)
+            in[i] = (float)std::sin(w * (n + i));
+        dsp.process(in, out, block);
+        for (unsigned i = 0; i < block; ++i) {
+            if (n + i >= skip) {
+                s += out[i] * std::sin(w * (n + i));
+                c += out[i] * std::cos(w * (n + i));
+            }
+        }
+    }
+
+    std::printf("%.9g %.9g\n", std::atan2(-c, s) / w, (double)dsp.latency());
+    return 0;
+}
+'''
+
+def have_program(name: str) -> bool:
+    return shutil.which(name) is not None
+
+@unittest.skipUnless(have_program(FAUST) and have_program(CXX), 'faust or the C++ compiler is missing')
+class TestLatency(unittest.TestCase):
+    def measure(self, directory: str, ratio: str, filtertype: str) -> Tuple[float, float]:
+        dspfile: str = os.path.join(directory, 'pass.dsp')
+        with open(dspfile, 'w') as file:
+            file.write('process = _;\n')
+        with open(os.path.join(directory, 'main.cpp'), 'w') as file:
+            file.write(MAIN_SOURCE)
+
+        for ext in ('hpp', 'cpp'):
+            subprocess.check_call([
+                sys.executable, os.path.join(ROOT, 'run-faustpp.py'),
+                '-a', os.path.join(ROOT, 'faustpp', 'architectures', 'oversampled.' + ext),
+                '-DIdentifier=Latency', '-DOversampling=' + ratio, '-DOversamplingFilter=' + filtertype,
+                dspfile, '-o', os.path.join(directory, 'Latency.' + ext)])
+
+        program: str = os.path.join(directory, 'latency')
+        subprocess.check_call([
+            CXX, '-std=c++11', '-O2', '-I' + directory, '-I' + os.path.join(ROOT, 'thirdparty', 'hiir'),
+            os.path.join(directory, 'main.cpp'), os.path.join(directory, 'Latency.cpp'), '-o', program])
+
+        measured, reported = subprocess.check_output([program]).decode('utf-8').split()
+        return (float(measured), float(reported))
+
+    def test_latency(self):
+        for ratio, filtertype in CASES:
+            with self.subTest(ratio=ratio, filter=filtertype), tempfile.TemporaryDirectory() as directory:
+                measured, reported = self.measure(directory, ratio, filtertype)
+                self.assertAlmostEqual(measured, reported, delta=TOLERANCE)
+
+if __name__ == '__main__':
+    unittest.main()